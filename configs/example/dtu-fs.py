@@ -31,6 +31,7 @@ import optparse
 import os
 
 import m5
+from m5.internal.stats import periodicStatDump
 from m5.objects import *
 from m5.util import addToPath, fatal
 
@@ -68,6 +69,24 @@ parser.add_option("--init_mem", default="", type="string",
                   help="file to load into the memory-PE")
 parser.add_option("--debug", default="",
                   help = "the binary to debug")
+parser.add_option("--noc-topology", type="choice", default="xbar",
+                  choices=["xbar", "mesh", "torus"],
+                  help = "the NoC that connects the PEs (xbar, mesh or torus)")
+parser.add_option("--noc-cols", type="int", default=0,
+                  help = "number of columns of the mesh/torus (0 = as square as possible)")
+parser.add_option("--pmem-checkpoint", type="choice", default="gzip",
+                  choices=['gzip', 'pages', 'delta'],
+                  help = "checkpoint format of the memories (gzip, pages or delta)")
+parser.add_option("--parallel", action="store_true",
+                  help = "simulate each PE in its own thread (the NoC stays in the main thread); "
+                  "atomic and functional accesses across the NoC are not supported then")
+parser.add_option("--quantum", type="int", default=0,
+                  help = "the simulation quantum in ticks for --parallel; at most the latency of "
+                  "the links between the PEs and the NoC, which is half the NoC latency "
+                  "(0 = the link latency) [default: %default]")
+parser.add_option("--stats-period", type="int", default=0,
+                  help = "dump and reset the statistics every given number of ticks "
+                  "(consider --stats-format=binary)")
 
 parser.add_option("--list-mem-types",
                   action="callback", callback=_listMemTypes,
@@ -83,6 +102,9 @@ parser.add_option("--mem-channels", type="int", default=1,
 parser.add_option("--mem-ranks", type="int", default=None,
                   help = "number of memory ranks per channel")
 
+parser.add_option("--no-dtu-pool", action="store_true",
+                  help = "don't let the DTUs recycle their packets (to compare host speed)")
+
 parser.add_option("--watch-pe", type="int", default=-1,
                   help = "the PE number for memory watching")
 parser.add_option("--watch-start", type="int", default=0,
@@ -163,6 +185,7 @@ def createPE(no, mem=False, cache=True, memPE=0):
         pe = MemSystem(mem_mode = CPUClass.memory_mode())
     else:
         pe = M3X86System(mem_mode = CPUClass.memory_mode())
+    pe.pmem_checkpoint = options.pmem_checkpoint
     setattr(root, 'pe%d' % no, pe)
 
     # TODO set latencies
@@ -173,12 +196,23 @@ def createPE(no, mem=False, cache=True, memPE=0):
 
     pe.dtu = Dtu()
     pe.dtu.core_id = no
+    pe.dtu.pool_packets = not options.no_dtu_pool
 
     pe.dtu.icache_master_port = pe.xbar.slave
     pe.dtu.dcache_master_port = pe.xbar.slave
 
-    pe.dtu.noc_master_port = root.noc.slave
-    pe.dtu.noc_slave_port  = root.noc.master
+    if options.parallel:
+        # the PE gets its own event queue (and thread), whereas the NoC stays in the first one.
+        # packets are exchanged between them via a link that takes over half the NoC latency.
+        pe.eventq_index = no + 1
+        pe.noc_link = NocLink(latency = '%dt' % link_latency)
+        pe.dtu.noc_master_port = pe.noc_link.pe_slave
+        pe.dtu.noc_slave_port  = pe.noc_link.pe_master
+        pe.noc_link.noc_master = root.noc.slave
+        pe.noc_link.noc_slave  = root.noc.master
+    else:
+        pe.dtu.noc_master_port = root.noc.slave
+        pe.dtu.noc_slave_port  = root.noc.master
 
     if not mem:
         if cache:
@@ -250,8 +284,15 @@ def createCorePE(no, cache, memPE):
         pe.rgdb_wait = 0
 
     # connect the IO space via bridge to the root NoC
-    pe.bridge = Bridge(delay='50ns')
-    pe.bridge.master = root.noc.slave
+    if options.parallel:
+        # the link latency is taken out of the bridge delay
+        pe.bridge = Bridge(delay = '%dt' % (m5.ticks.fromSeconds(50e-9) - link_latency))
+        pe.io_link = NocLink(latency = '%dt' % link_latency)
+        pe.bridge.master = pe.io_link.pe_slave
+        pe.io_link.noc_master = root.noc.slave
+    else:
+        pe.bridge = Bridge(delay='50ns')
+        pe.bridge.master = root.noc.slave
     pe.bridge.slave = pe.xbar.master
     pe.bridge.ranges = \
         [
@@ -274,6 +315,8 @@ def createMemPE(no, size, content=None):
     pe.mem_ctrl.device_size = size
     pe.mem_ctrl.range = MemorySize(size).value
     pe.mem_ctrl.port = pe.xbar.master
+    # only the touched pages of the memory need host memory
+    pe.mmap_using_noreserve = True
     if not content is None:
         pe.mem_file = content
     print 'PE%d: %s' % (no, content)
@@ -286,6 +329,22 @@ def createMemPE(no, size, content=None):
 # Set up the system
 root = Root(full_system = True)
 
+# the NoC needs one cycle to forward a request or response. in parallel mode, the PEs are connected
+# to the NoC via links, whose latency is the lookahead between the threads. a packet traverses two
+# links from PE to PE, so that each of them takes over half of the NoC latency, which keeps the
+# simulated timing the same as without --parallel.
+noc_latency = 1
+if options.parallel:
+    m5.ticks.fixGlobalFrequency()
+    noc_period = m5.ticks.fromSeconds(1.0 / m5.util.convert.toFrequency(options.sys_clock))
+    link_latency = noc_period * noc_latency / 2
+    if link_latency == 0:
+        fatal("The NoC latency is too small to be split into links")
+    if options.quantum > link_latency:
+        fatal("The quantum (%d) exceeds the link latency (%d)" % (options.quantum, link_latency))
+    root.sim_quantum = options.quantum if options.quantum > 0 else link_latency
+    noc_latency = 0
+
 # Create a top-level voltage domain
 root.voltage_domain = VoltageDomain(voltage = options.sys_voltage)
 
@@ -300,12 +359,32 @@ root.cpu_voltage_domain = VoltageDomain()
 root.cpu_clk_domain = SrcClockDomain(clock = options.cpu_clock,
                                      voltage_domain = root.cpu_voltage_domain)
 
-# All PEs are connected to a NoC (Network on Chip). In this case it's just
-# a simple XBar.
-root.noc = NoncoherentXBar(forward_latency  = 0,
-                           frontend_latency = 1,
-                           response_latency = 1,
-                           width = 8)
+# All PEs are connected to a NoC (Network on Chip). This is either a simple
+# XBar or a mesh/torus, where PE <no> sits at (no % cols, no / cols).
+if options.noc_topology == "xbar":
+    # the PEs are addressed by the upper 8 bits of the NoC address, so
+    # that they can be found by a direct table lookup
+    root.noc = NoncoherentXBar(forward_latency  = 0,
+                               frontend_latency = noc_latency,
+                               response_latency = noc_latency,
+                               width = 8,
+                               decode_shift = 56)
+else:
+    # the core PEs and the memory PE
+    noc_pes = options.num_pes + 1
+    noc_cols = options.noc_cols
+    if noc_cols == 0:
+        noc_cols = int(math.ceil(math.sqrt(noc_pes)))
+    noc_rows = (noc_pes + noc_cols - 1) / noc_cols
+    root.noc = DtuNoc(forward_latency  = 0,
+                      frontend_latency = noc_latency,
+                      response_latency = noc_latency,
+                      width = 8,
+                      topology = options.noc_topology,
+                      cols = noc_cols,
+                      rows = noc_rows)
+    print 'NoC: %s with %dx%d routers' % (options.noc_topology, noc_cols, noc_rows)
+    print
 
 # create a dummy platform and system for the UART
 root.platform = IOPlatform()
@@ -338,6 +417,9 @@ createMemPE(options.num_pes,
 # Instantiate configuration
 m5.instantiate()
 
+if options.stats_period > 0:
+    periodicStatDump(options.stats_period)
+
 # Simulate until program terminates
 exit_event = m5.simulate(options.maxtick)
 
@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+# either expressed or implied, of the FreeBSD Project.
+
+# Runs configs/example/dtu-traffic.py for all combinations of the given PE
+# counts, patterns, commands and sizes and prints a table with the aggregated
+# results of the traffic generators, e.g.:
+#
+#   configs/example/dtu-traffic-sweep.py -n 4,16 -p uniform,hotspot \
+#       -c send,read -s 64B,1kB build/X86/gem5.opt -- --ops=500
+#
+# The throughput is the sum over all generators; for the latencies, the median
+# is averaged and the 90th/99th percentiles are the worst of all generators.
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+
+def read_stats(path):
+    stats = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'^\S+\.gen\.(bytesPerSec|latency50|latency90|'
+                         r'latency99|ops|failedOps)\s+(\S+)', line)
+            if m:
+                stats.setdefault(m.group(1), []).append(float(m.group(2)))
+    return stats
+
+def run(gem5, config, outdir, args):
+    cmd = [gem5, '-d', outdir, config] + args
+    with open(os.devnull, 'w') as devnull:
+        subprocess.check_call(cmd, stdout=devnull, stderr=devnull)
+    return read_stats(os.path.join(outdir, 'stats.txt'))
+
+def split(value):
+    return [v for v in value.split(',') if v != '']
+
+parser = optparse.OptionParser(
+    usage="%prog [options] <gem5 binary> [-- <additional config args>]")
+parser.add_option("-n", "--num-pes", default="4",
+                  help="comma separated PE counts [default: %default]")
+parser.add_option("-p", "--patterns", default="uniform,hotspot,all_to_all",
+                  help="comma separated patterns [default: %default]")
+parser.add_option("-c", "--commands", default="send,send_reply,read,write",
+                  help="comma separated commands [default: %default]")
+parser.add_option("-s", "--sizes", default="64B,256B,960B",
+                  help="comma separated sizes; each is a separate run "
+                  "[default: %default]")
+parser.add_option("-o", "--outdir", default="dtu-traffic",
+                  help="directory for the outputs [default: %default]")
+
+(options, args) = parser.parse_args()
+
+if len(args) < 1:
+    parser.print_help()
+    sys.exit(1)
+
+gem5, common_args = args[0], args[1:]
+config = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      'dtu-traffic.py')
+
+print "%-5s %-11s %-11s %-7s %8s %8s %14s %8s %8s %8s" % \
+    ('pes', 'pattern', 'command', 'size', 'ops', 'failed', 'bytes/s',
+     'p50', 'p90', 'p99')
+
+for pes in split(options.num_pes):
+    for pattern in split(options.patterns):
+        for command in split(options.commands):
+            for size in split(options.sizes):
+                name = '%s-%s-%s-%s' % (pes, pattern, command, size)
+                outdir = os.path.join(options.outdir, name)
+                stats = run(gem5, config, outdir, common_args + [
+                    '--num-pes=%s' % pes,
+                    '--pattern=%s' % pattern,
+                    '--command=%s' % command,
+                    '--sizes=%s' % size,
+                ])
+
+                # PE 0 does not generate traffic with the hotspot pattern
+                active = [i for i, ops in enumerate(stats['ops']) if ops > 0]
+                def pick(stat):
+                    return [stats[stat][i] for i in active]
+
+                p50 = pick('latency50')
+                print "%-5s %-11s %-11s %-7s %8d %8d %14.0f %8.0f %8.0f %8.0f" % \
+                    (pes, pattern, command, size,
+                     sum(stats['ops']), sum(stats['failedOps']),
+                     sum(stats['bytesPerSec']),
+                     sum(p50) / max(len(p50), 1),
+                     max(pick('latency90') + [0]),
+                     max(pick('latency99') + [0]))
+                sys.stdout.flush()
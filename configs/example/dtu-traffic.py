@@ -0,0 +1,179 @@
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+# either expressed or implied, of the FreeBSD Project.
+
+
+# Drives the DTUs of a number of PEs by traffic generators instead of CPUs to
+# measure the throughput and the latency of the DTU and the NoC, e.g.:
+#
+#   build/X86/gem5.opt configs/example/dtu-traffic.py --num-pes=16 \
+#       --pattern=hotspot --command=send_reply --sizes=64B,512B
+#
+# Each generator reports its results at the end and in the stats (opLatency,
+# latency50/90/99 and bytesPerSec). In the hotspot pattern, PE 0 plays the
+# kernel: it does not generate traffic itself, but serves the messages of the
+# others.
+
+import optparse
+import sys
+
+import m5
+from m5.objects import *
+from m5.util.convert import toMemorySize
+
+parser = optparse.OptionParser()
+
+parser.add_option("-a", "--atomic", action="store_true",
+                  help="Use atomic (non-timing) mode")
+parser.add_option("-m", "--maxtick", type="int", default=m5.MaxTick,
+                  metavar="T",
+                  help="Stop after T ticks")
+parser.add_option("--sys-clock", action="store", type="string",
+                  default='1GHz',
+                  help = """Top-level clock for blocks running at system
+                  speed""")
+parser.add_option("--num-pes", type="int", default=4,
+                  help = "Number of PEs (processing elements) in the system "
+                  "[default:%default]")
+parser.add_option("--pattern", type="choice", default="uniform",
+                  choices=["uniform", "hotspot", "all_to_all"],
+                  help = "how the targets are chosen [default:%default]")
+parser.add_option("--hotspot-percent", type="int", default=90,
+                  help = "percentage of the operations to PE 0 with the "
+                  "hotspot pattern [default:%default]")
+parser.add_option("--command", type="choice", default="send",
+                  choices=["send", "send_reply", "read", "write"],
+                  help = "the DTU command to issue [default:%default]")
+parser.add_option("--sizes", type="string", default="64B",
+                  help = "comma separated list of sizes to choose from "
+                  "[default:%default]")
+parser.add_option("--ops", type="int", default=1000,
+                  help = "number of operations per PE [default:%default]")
+parser.add_option("--gap", type="int", default=0,
+                  help = "cycles between two operations [default:%default]")
+parser.add_option("--burst-length", type="int", default=0,
+                  help = "operations per burst; 0 disables bursts "
+                  "[default:%default]")
+parser.add_option("--burst-gap", type="int", default=1000,
+                  help = "cycles between two bursts [default:%default]")
+parser.add_option("--seed", type="int", default=1,
+                  help = "seed for the random choices [default:%default]")
+
+(options, args) = parser.parse_args()
+
+if args:
+    print "Error: script doesn't take any positional arguments"
+    sys.exit(1)
+
+if options.num_pes < 2:
+    print "Error: Need at least two PEs"
+    sys.exit(1)
+
+sizes = [toMemorySize(s) for s in options.sizes.split(",")]
+max_size = max(sizes)
+
+# a message and its header have to fit into a receive buffer slot and into a
+# NoC packet. the slot size also determines where the buffers are placed.
+header_size = 22  # sizeof(Dtu::MessageHeader)
+slot_size = 1024
+while slot_size < max_size + header_size:
+    slot_size *= 2
+buf_addr = 0x1000
+msg_slots = 16
+
+root = Root(full_system = False)
+
+root.voltage_domain = VoltageDomain(voltage = '1V')
+root.clk_domain = SrcClockDomain(clock = options.sys_clock,
+                                 voltage_domain = root.voltage_domain)
+
+# the PEs are addressed by the upper 8 bits of the NoC address
+root.noc = NoncoherentXBar(forward_latency  = 0,
+                           frontend_latency = 1,
+                           response_latency = 1,
+                           width = 8,
+                           decode_shift = 56)
+
+for i in range(0, options.num_pes):
+    # each PE is represented by it's own system
+    pe = System(mem_mode = 'atomic' if options.atomic else 'timing')
+    setattr(root, 'pe%d' % i, pe)
+
+    pe.xbar = NoncoherentXBar(forward_latency  = 0,
+                              frontend_latency = 0,
+                              response_latency = 1,
+                              width = 16)
+
+    pe.spm = Scratchpad(in_addr_map = "true")
+    pe.spm.cpu_port = pe.xbar.master
+
+    pe.dtu = Dtu()
+    pe.dtu.core_id = i
+    pe.dtu.max_noc_packet_size = '%dB' % slot_size
+    pe.dtu.block_size = pe.dtu.max_noc_packet_size
+    pe.dtu.buf_size = pe.dtu.max_noc_packet_size
+
+    pe.dtu.icache_master_port = pe.xbar.slave
+    pe.dtu.dcache_master_port = pe.xbar.slave
+    pe.dtu.noc_master_port = root.noc.slave
+    pe.dtu.noc_slave_port  = root.noc.master
+
+    pe.gen = DtuTrafficGen()
+    pe.gen.core_id = i
+    pe.gen.port = pe.dtu.dcache_slave_port
+    pe.gen.peers = [p for p in range(0, options.num_pes) if p != i]
+    pe.gen.pattern = options.pattern
+    pe.gen.hotspot = 0
+    pe.gen.hotspot_percent = options.hotspot_percent
+    pe.gen.command = options.command
+    pe.gen.sizes = ['%dB' % s for s in sizes]
+    pe.gen.num_ops = options.ops
+    pe.gen.op_gap = options.gap
+    pe.gen.burst_length = options.burst_length
+    pe.gen.burst_gap = options.burst_gap
+    pe.gen.seed = options.seed
+    pe.gen.msg_slot_size = '%dB' % slot_size
+    pe.gen.msg_slots = msg_slots
+    pe.gen.buf_addr = buf_addr
+
+    if options.pattern == "hotspot" and i == 0:
+        pe.gen.num_ops = 0
+
+    # the data area, the receive buffer and the reply buffer
+    data_size = ((max_size + slot_size - 1) / slot_size) * slot_size
+    pe.spm.range = max(128 * 1024,
+                       buf_addr + data_size + slot_size * (msg_slots + 1))
+
+    pe.system_port = pe.xbar.slave
+
+# Instantiate configuration
+m5.instantiate()
+
+# Simulate until all generators are done
+exit_event = m5.simulate(options.maxtick)
+
+print 'Exiting @ tick', m5.curTick(), 'because', exit_event.getCause()
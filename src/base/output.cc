@@ -133,14 +133,48 @@ OutputDirectory::close(ostream *openStream) {
 void
 OutputDirectory::setDirectory(const string &d)
 {
-    if (!dir.empty())
-        panic("Output directory already set!\n");
+    const string old_dir = dir;
 
     dir = d;
 
     // guarantee that directory ends with a path separator
     if (dir[dir.size() - 1] != PATH_SEPARATOR)
         dir += PATH_SEPARATOR;
+
+    if (old_dir.empty() || old_dir == dir)
+        return;
+
+    map_t relocated;
+    for (map_t::iterator i = files.begin(); i != files.end(); i++) {
+        // files outside of the directory stay where they are
+        if (i->first.compare(0, old_dir.size(), old_dir) != 0) {
+            relocated[i->first] = i->second;
+            continue;
+        }
+
+        const string filename = dir + i->first.substr(old_dir.size());
+        ofstream *fs = dynamic_cast<ofstream*>(i->second);
+        if (fs) {
+            fs->close();
+            fs->open(filename.c_str(), ios::trunc | ios::binary);
+            if (!fs->is_open())
+                fatal("Cannot open file %s", filename);
+            relocated[filename] = fs;
+        } else {
+            // closing a compressed stream would write its trailer to the
+            // old file, which might still be in use
+            warn("Not moving compressed file %s to %s\n", i->first, dir);
+            relocated[i->first] = i->second;
+        }
+    }
+    files.swap(relocated);
+}
+
+void
+OutputDirectory::flush()
+{
+    for (map_t::iterator i = files.begin(); i != files.end(); i++)
+        i->second->flush();
 }
 
 const string &
@@ -93,10 +93,20 @@ class OutputDirectory
 
     /**
      * Sets name of this directory.
+     *
+     * If the directory has been set before, the files that are open in
+     * the old directory are reopened (and truncated) in the new one. The
+     * streams stay valid; what has been written to them so far stays in
+     * the old directory. This is used to give a forked simulator its own
+     * output directory.
+     *
      * @param dir name of this directory
      */
     void setDirectory(const std::string &dir);
 
+    /** Flushes all open files. */
+    void flush();
+
     /**
      * Gets name of this directory.
      * @return name of this directory
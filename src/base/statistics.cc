@@ -38,6 +38,7 @@
 #include "base/cprintf.hh"
 #include "base/debug.hh"
 #include "base/hostinfo.hh"
+#include "base/match.hh"
 #include "base/misc.hh"
 #include "base/statistics.hh"
 #include "base/str.hh"
@@ -50,6 +51,10 @@ namespace Stats {
 
 std::string Info::separatorString = "::";
 
+// the number of the dump in progress, 0 outside of dumps
+static uint64_t currentDump = 0;
+static uint64_t dumpCount = 0;
+
 // We wrap these in a function to make sure they're built in time.
 list<Info *> &
 statsList()
@@ -374,10 +379,12 @@ HistStor::add(HistStor *hs)
 }
 
 Formula::Formula()
+    : resultDump(0), totalDump(0)
 {
 }
 
 Formula::Formula(Temp r)
+    : resultDump(0), totalDump(0)
 {
     root = r.getNodePtr();
     setInit();
@@ -421,14 +428,35 @@ Formula::operator/=(Temp r)
 void
 Formula::result(VResult &vec) const
 {
-    if (root)
+    if (!root)
+        return;
+
+    if (currentDump == 0) {
         vec = root->result();
+        return;
+    }
+
+    if (resultDump != currentDump) {
+        cachedResult = root->result();
+        resultDump = currentDump;
+    }
+    vec = cachedResult;
 }
 
 Result
 Formula::total() const
 {
-    return root ? root->total() : 0.0;
+    if (!root)
+        return 0.0;
+
+    if (currentDump == 0)
+        return root->total();
+
+    if (totalDump != currentDump) {
+        cachedTotal = root->total();
+        totalDump = currentDump;
+    }
+    return cachedTotal;
 }
 
 size_type
@@ -507,6 +535,14 @@ enable()
     if (_enabled)
         fatal("Stats are already enabled");
 
+    // dump in the order of the names, like the Python side does
+    statsList().sort([](const Info *a, const Info *b) {
+        vector<string> v1, v2;
+        tokenize(v1, a->name, '.');
+        tokenize(v2, b->name, '.');
+        return v1 < v2;
+    });
+
     _enabled = true;
 }
 
@@ -519,6 +555,29 @@ dump()
         fatal("No registered Stats::dump handler");
 }
 
+void
+dumpOutput(Output &output, const vector<string> &select)
+{
+    ObjectMatch filter;
+    filter.setExpression(select);
+
+    currentDump = ++dumpCount;
+
+    output.begin();
+    for (auto info : statsList()) {
+        if (!select.empty() && !filter.match(info->name))
+            continue;
+        if (!output.wanted(*info))
+            continue;
+
+        info->prepare();
+        info->visit(output);
+    }
+    output.end();
+
+    currentDump = 0;
+}
+
 void
 reset()
 {
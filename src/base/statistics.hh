@@ -2882,6 +2882,16 @@ class Formula : public DataWrapVec<Formula, FormulaInfoProxy>
     NodePtr root;
     friend class Temp;
 
+    /**
+     * The stats do not change during a dump, so that the results are
+     * only calculated once per dump, even if the formula is used by
+     * other formulas.
+     */
+    mutable VResult cachedResult;
+    mutable Result cachedTotal;
+    mutable uint64_t resultDump;
+    mutable uint64_t totalDump;
+
   public:
     /**
      * Create and initialize thie formula, and register it with the database.
@@ -3211,6 +3221,15 @@ sum(Temp val)
 
 /** Dump all statistics data to the registered outputs */
 void dump();
+
+/**
+ * Writes the stats to <output> in the order of their names. Stats that
+ * the output does not want (see Output::wanted) are neither prepared
+ * nor visited. If <select> is not empty, only the stats matching one of
+ * its expressions (see ObjectMatch) are written.
+ */
+void dumpOutput(Output &output, const std::vector<std::string> &select);
+
 void reset();
 void enable();
 bool enabled();
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "base/stats/binary.hh"
+#include "base/stats/info.hh"
+#include "base/misc.hh"
+#include "base/output.hh"
+#include "sim/core.hh"
+
+using namespace std;
+
+namespace Stats {
+
+namespace {
+
+template<typename T>
+void
+write(ostream &os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+string
+indexName(const vector<string> &subnames, off_type i)
+{
+    if (i < subnames.size() && !subnames[i].empty())
+        return subnames[i];
+    return to_string(i);
+}
+
+// formats bucket bounds and keys as the text output does
+string
+counterName(const string &base, Counter low, Counter high)
+{
+    stringstream name;
+    name << base << low;
+    if (low < high)
+        name << "-" << high;
+    return name.str();
+}
+
+} // anonymous namespace
+
+Binary::Binary()
+    : stream(NULL), schema(0), names(), layout(), values(), visited(0),
+      changed(false)
+{
+}
+
+Binary::~Binary()
+{
+}
+
+void
+Binary::open(ostream &_stream)
+{
+    if (stream)
+        panic("stream already set!");
+
+    stream = &_stream;
+    if (!valid())
+        fatal("Unable to open output stream for writing\n");
+
+    stream->write("GEM5STAT", 8);
+    write<uint32_t>(*stream, VERSION);
+    write<uint32_t>(*stream, 0);
+}
+
+bool
+Binary::valid() const
+{
+    return stream != NULL && stream->good();
+}
+
+void
+Binary::begin()
+{
+    values.clear();
+    visited = 0;
+    // the first dump defines the schema
+    changed = schema == 0;
+    if (changed) {
+        names.clear();
+        layout.clear();
+    }
+}
+
+void
+Binary::end()
+{
+    // stats might have disappeared at the end
+    if (!changed && visited != layout.size())
+        changed = true;
+
+    if (changed) {
+        layout.resize(visited);
+        assert(names.size() == values.size());
+        schema++;
+        writeSchema();
+    }
+
+    writeDump();
+    stream->flush();
+}
+
+void
+Binary::writeSchema()
+{
+    write<uint32_t>(*stream, SCHEMA);
+    write<uint32_t>(*stream, schema);
+    write<uint32_t>(*stream, names.size());
+    for (auto &name : names) {
+        assert(name.size() <= UINT16_MAX);
+        write<uint16_t>(*stream, name.size());
+        stream->write(name.data(), name.size());
+    }
+}
+
+void
+Binary::writeDump()
+{
+    write<uint32_t>(*stream, DUMP);
+    write<uint32_t>(*stream, schema);
+    write<uint64_t>(*stream, curTick());
+    write<uint32_t>(*stream, values.size());
+    stream->write(reinterpret_cast<const char*>(values.data()),
+                  values.size() * sizeof(Result));
+}
+
+bool
+Binary::wanted(const Info &info) const
+{
+    // in contrast to the text output, zero stats and stats with a zero
+    // prerequisite are written as well to keep the layout stable
+    return info.flags.isSet(display);
+}
+
+bool
+Binary::noOutput(const Info &info)
+{
+    return !wanted(info);
+}
+
+bool
+Binary::beginStat(const Info &info, size_t cols)
+{
+    if (!changed) {
+        if (visited >= layout.size() ||
+            layout[visited].first != info.id ||
+            layout[visited].second != cols) {
+            // keep the columns of the stats before; they are unchanged
+            changed = true;
+            layout.resize(visited);
+            names.resize(values.size());
+        }
+    }
+
+    if (changed)
+        layout.push_back(make_pair(info.id, cols));
+    visited++;
+    return changed;
+}
+
+void
+Binary::visit(const ScalarInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    if (beginStat(info, 1))
+        names.push_back(info.name);
+    values.push_back(info.result());
+}
+
+void
+Binary::visit(const VectorInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    const VResult &vec = info.result();
+    size_type size = vec.size();
+    bool total = info.flags.isSet(::Stats::total) && size > 1;
+
+    if (beginStat(info, size + total)) {
+        string base = info.name + info.separatorString;
+        for (off_type i = 0; i < size; ++i) {
+            names.push_back(size == 1 ? info.name
+                                      : base + indexName(info.subnames, i));
+        }
+        if (total)
+            names.push_back(base + "total");
+    }
+
+    values.insert(values.end(), vec.begin(), vec.end());
+    if (total)
+        values.push_back(info.total());
+}
+
+void
+Binary::visit(const Vector2dInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type size = info.x * info.y;
+    bool total = info.flags.isSet(::Stats::total) && info.x > 1;
+
+    if (beginStat(info, size + total)) {
+        for (off_type i = 0; i < info.x; ++i) {
+            string base = info.name + "_" + indexName(info.subnames, i) +
+                info.separatorString;
+            for (off_type j = 0; j < info.y; ++j)
+                names.push_back(base + indexName(info.y_subnames, j));
+        }
+        if (total)
+            names.push_back(info.name + info.separatorString + "total");
+    }
+
+    Result sum = 0.0;
+    for (off_type i = 0; i < size; ++i) {
+        values.push_back(info.cvec[i]);
+        sum += info.cvec[i];
+    }
+    if (total)
+        values.push_back(sum);
+}
+
+size_t
+Binary::distColumns(const DistData &data)
+{
+    // samples, sum, squares, min_value and max_value
+    size_t cols = 5;
+    if (data.type == Dist)
+        cols += 2;
+    if (data.type != Deviation)
+        cols += data.cvec.size();
+    return cols;
+}
+
+void
+Binary::distNames(const string &name, const string &sep,
+                  const DistData &data)
+{
+    string base = name + sep;
+    names.push_back(base + "samples");
+    names.push_back(base + "sum");
+    names.push_back(base + "squares");
+    names.push_back(base + "min_value");
+    names.push_back(base + "max_value");
+
+    if (data.type == Deviation)
+        return;
+
+    if (data.type == Dist)
+        names.push_back(base + "underflows");
+
+    for (off_type i = 0; i < data.cvec.size(); ++i) {
+        Counter low = i * data.bucket_size + data.min;
+        Counter high = ::min(low + data.bucket_size - 1.0, data.max);
+        names.push_back(counterName(base, low, high));
+    }
+
+    if (data.type == Dist)
+        names.push_back(base + "overflows");
+}
+
+void
+Binary::distValues(const DistData &data)
+{
+    values.push_back(data.samples);
+    values.push_back(data.sum);
+    values.push_back(data.squares);
+    values.push_back(data.min_val);
+    values.push_back(data.max_val);
+
+    if (data.type == Deviation)
+        return;
+
+    if (data.type == Dist)
+        values.push_back(data.underflow);
+    values.insert(values.end(), data.cvec.begin(), data.cvec.end());
+    if (data.type == Dist)
+        values.push_back(data.overflow);
+}
+
+void
+Binary::visit(const DistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    if (beginStat(info, distColumns(info.data)))
+        distNames(info.name, info.separatorString, info.data);
+    distValues(info.data);
+}
+
+void
+Binary::visit(const VectorDistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_t cols = 0;
+    for (off_type i = 0; i < info.size(); ++i)
+        cols += distColumns(info.data[i]);
+
+    if (beginStat(info, cols)) {
+        for (off_type i = 0; i < info.size(); ++i) {
+            distNames(info.name + "_" + indexName(info.subnames, i),
+                      info.separatorString, info.data[i]);
+        }
+    }
+    for (off_type i = 0; i < info.size(); ++i)
+        distValues(info.data[i]);
+}
+
+void
+Binary::visit(const FormulaInfo &info)
+{
+    visit((const VectorInfo &)info);
+}
+
+void
+Binary::visit(const SparseHistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    const SparseHistData &data = info.data;
+    if (beginStat(info, 1 + data.cmap.size())) {
+        string base = info.name + info.separatorString;
+        names.push_back(base + "samples");
+        for (auto &it : data.cmap)
+            names.push_back(counterName(base, it.first, it.first));
+    }
+
+    values.push_back(data.samples);
+    for (auto &it : data.cmap)
+        values.push_back(it.second);
+}
+
+Output *
+initBinary(const string &filename)
+{
+    static Binary binary;
+    static bool connected = false;
+
+    if (!connected) {
+        ostream *os = simout.find(filename);
+        if (!os)
+            os = simout.create(filename, true);
+
+        binary.open(*os);
+        connected = true;
+    }
+
+    return &binary;
+}
+
+} // namespace Stats
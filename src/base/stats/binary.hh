@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __BASE_STATS_BINARY_HH__
+#define __BASE_STATS_BINARY_HH__
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/stats/output.hh"
+#include "base/stats/types.hh"
+
+namespace Stats {
+
+struct DistData;
+
+/**
+ * Writes the statistics in a compact, self-describing binary format,
+ * which is much faster to write and to load than the text output when
+ * dumping often. util/gem5stats.py reads it.
+ *
+ * Every statistic is flattened into columns of doubles, named like the
+ * lines of the text output (e.g., "system.cpu.ipc" or "foo::total").
+ * Distributions are stored as their raw moments (samples, sum, squares),
+ * their minimum and maximum and their buckets. The column names (the
+ * schema) are written once and each dump appends a row of values. A new
+ * schema is only written if the layout changes, e.g., because a sparse
+ * histogram got a new key.
+ *
+ * The file starts with the magic "GEM5STAT" and the version and
+ * continues with blocks, each starting with its type and the id of its
+ * schema as 32-bit integers:
+ * - SCHEMA: the number of columns (32 bit) and for each column the
+ *   length of its name (16 bit) followed by the name.
+ * - DUMP: the tick (64 bit), the number of columns (32 bit) and the
+ *   values.
+ * All values are stored in little endian.
+ */
+class Binary : public Output
+{
+  public:
+    static const uint32_t VERSION = 1;
+
+    enum BlockType : uint32_t
+    {
+        SCHEMA = 1,
+        DUMP = 2,
+    };
+
+  protected:
+    std::ostream *stream;
+
+    /** The id of the current schema. */
+    uint32_t schema;
+    /** The column names of the current schema. */
+    std::vector<std::string> names;
+    /** The id and the number of columns per stat in the current schema. */
+    std::vector<std::pair<int, size_t>> layout;
+
+    /** The values of the current dump. */
+    std::vector<Result> values;
+    /** The number of stats that have been visited in the current dump. */
+    size_t visited;
+    /** Whether the current dump does not match the schema. */
+    bool changed;
+
+  protected:
+    bool noOutput(const Info &info);
+
+    /**
+     * Starts a stat with <cols> columns. Returns whether the names of
+     * its columns have to be added, because the schema has changed.
+     */
+    bool beginStat(const Info &info, size_t cols);
+
+    static size_t distColumns(const DistData &data);
+    void distNames(const std::string &name, const std::string &sep,
+                   const DistData &data);
+    void distValues(const DistData &data);
+
+    void writeSchema();
+    void writeDump();
+
+  public:
+    Binary();
+    ~Binary();
+
+    void open(std::ostream &stream);
+
+    // Implement Visit
+    virtual void visit(const ScalarInfo &info);
+    virtual void visit(const VectorInfo &info);
+    virtual void visit(const DistInfo &info);
+    virtual void visit(const VectorDistInfo &info);
+    virtual void visit(const Vector2dInfo &info);
+    virtual void visit(const FormulaInfo &info);
+    virtual void visit(const SparseHistInfo &info);
+
+    // Implement Output
+    virtual bool valid() const;
+    virtual bool wanted(const Info &info) const;
+    virtual void begin();
+    virtual void end();
+};
+
+Output *initBinary(const std::string &filename);
+
+} // namespace Stats
+
+#endif // __BASE_STATS_BINARY_HH__
@@ -52,6 +52,13 @@ struct Output
     virtual void end() = 0;
     virtual bool valid() const = 0;
 
+    /**
+     * Whether this output writes the given stat at all. Dumps skip the
+     * stats that are not wanted before preparing them, which is much
+     * cheaper than visiting them.
+     */
+    virtual bool wanted(const Info &info) const { return true; }
+
     virtual void visit(const ScalarInfo &info) = 0;
     virtual void visit(const VectorInfo &info) = 0;
     virtual void visit(const DistInfo &info) = 0;
@@ -81,18 +81,18 @@ namespace Stats {
 std::list<Info *> &statsList();
 
 Text::Text()
-    : mystream(false), stream(NULL), descriptions(false)
+    : mystream(false), stream(NULL), descriptions(false), skipZero(false)
 {
 }
 
 Text::Text(std::ostream &stream)
-    : mystream(false), stream(NULL), descriptions(false)
+    : mystream(false), stream(NULL), descriptions(false), skipZero(false)
 {
     open(stream);
 }
 
 Text::Text(const std::string &file)
-    : mystream(false), stream(NULL), descriptions(false)
+    : mystream(false), stream(NULL), descriptions(false), skipZero(false)
 {
     open(file);
 }
@@ -149,6 +149,18 @@ Text::end()
     stream->flush();
 }
 
+bool
+Text::wanted(const Info &info) const
+{
+    if (!info.flags.isSet(display))
+        return false;
+
+    if (info.prereq && info.prereq->zero())
+        return false;
+
+    return !skipZero || !info.zero();
+}
+
 bool
 Text::noOutput(const Info &info)
 {
@@ -734,7 +746,7 @@ Text::visit(const SparseHistInfo &info)
 }
 
 Output *
-initText(const string &filename, bool desc)
+initText(const string &filename, bool desc, bool skipZero)
 {
     static Text text;
     static bool connected = false;
@@ -746,6 +758,7 @@ initText(const string &filename, bool desc)
 
         text.open(*os);
         text.descriptions = desc;
+        text.skipZero = skipZero;
         connected = true;
     }
 
@@ -51,6 +51,8 @@ class Text : public Output
 
   public:
     bool descriptions;
+    /** Whether stats that are zero are left out entirely. */
+    bool skipZero;
 
   public:
     Text();
@@ -72,13 +74,15 @@ class Text : public Output
 
     // Implement Output
     virtual bool valid() const;
+    virtual bool wanted(const Info &info) const;
     virtual void begin();
     virtual void end();
 };
 
 std::string ValueToString(Result value, int precision);
 
-Output *initText(const std::string &filename, bool desc);
+Output *initText(const std::string &filename, bool desc,
+                 bool skipZero = false);
 
 } // namespace Stats
 
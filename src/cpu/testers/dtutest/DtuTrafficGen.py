@@ -0,0 +1,66 @@
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+# either expressed or implied, of the FreeBSD Project.
+
+
+from MemObject import MemObject
+from m5.params import *
+from m5.proxy import *
+
+class DtuTrafficPattern(Enum): vals = ['uniform', 'hotspot', 'all_to_all']
+
+class DtuTrafficCommand(Enum): vals = ['send', 'send_reply', 'read', 'write']
+
+class DtuTrafficGen(MemObject):
+    type = 'DtuTrafficGen'
+    cxx_header = "cpu/testers/dtutest/dtu_traffic_gen.hh"
+    port = MasterPort("Port to the DTU and Scratch-Pad-Memory")
+    system = Param.System(Parent.any, "System this generator is part of")
+    core_id = Param.Unsigned("ID of the core of this generator (same as the one of the DTU)")
+
+    regfile_base_addr = Param.Addr(0xF0000000, "Register file address of the DTU")
+    num_cmd_epid_bits = Param.Unsigned(8, "Number of bits for the endpoint in a command (as in the DTU)")
+
+    peers = VectorParam.Unsigned([], "The core ids of the PEs to send to or to read from/write to")
+    pattern = Param.DtuTrafficPattern('uniform', "How the target of an operation is chosen")
+    hotspot = Param.Unsigned(0, "The core id of the hotspot (e.g., the kernel PE)")
+    hotspot_percent = Param.Percent(90, "Percentage of the operations that go to the hotspot")
+
+    command = Param.DtuTrafficCommand('send', "The DTU command to issue")
+    sizes = VectorParam.MemorySize(['64B'], "The sizes to pick the size of each operation from")
+    num_ops = Param.Unsigned(1000, "Number of operations to issue (0 = only serve the others)")
+
+    op_gap = Param.Cycles(0, "Cycles between the start of two operations")
+    burst_length = Param.Unsigned(0, "Number of operations per burst (0 = no bursts)")
+    burst_gap = Param.Cycles(1000, "Cycles between the start of the last and the first operation of two bursts")
+    poll_interval = Param.Cycles(1, "Cycles between two polls of the DTU registers")
+    seed = Param.Unsigned(1, "Seed for the random choices (the core id is added)")
+
+    # the header and the largest message need to fit into a slot and into a NoC packet
+    msg_slot_size = Param.MemorySize("1kB", "Size of a slot in the receive buffers")
+    msg_slots = Param.Unsigned(16, "Number of slots in the receive buffer")
+    buf_addr = Param.Addr(0x1000, "Local address of the data and the receive buffers")
@@ -0,0 +1,600 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "base/misc.hh"
+#include "cpu/testers/dtutest/dtu_traffic_gen.hh"
+#include "debug/DtuTrafficGen.hh"
+#include "sim/sim_exit.hh"
+#include "sim/system.hh"
+
+std::atomic<unsigned> DtuTrafficGen::running(0);
+
+bool
+DtuTrafficGen::CpuPort::recvTimingResp(PacketPtr pkt)
+{
+    gen.completeAccess(pkt);
+    return true;
+}
+
+void
+DtuTrafficGen::CpuPort::recvReqRetry()
+{
+    assert(gen.retryPkt);
+    if (sendTimingReq(gen.retryPkt))
+        gen.retryPkt = nullptr;
+}
+
+DtuTrafficGen::DtuTrafficGen(const DtuTrafficGenParams *p)
+  : MemObject(p),
+    tickEvent(this),
+    port("port", this),
+    masterId(p->system->getMasterId(name())),
+    atomic(p->system->isAtomicMode()),
+    coreId(p->core_id),
+    regFileBase(p->regfile_base_addr),
+    numCmdEpidBits(p->num_cmd_epid_bits),
+    peers(p->peers),
+    pattern(p->pattern),
+    hotspot(p->hotspot),
+    hotspotPercent(p->hotspot_percent),
+    command(p->command),
+    sizes(p->sizes),
+    numOps(p->num_ops),
+    opGap(p->op_gap),
+    burstLength(p->burst_length),
+    burstGap(p->burst_gap),
+    pollInterval(p->poll_interval),
+    slotSize(p->msg_slot_size),
+    slots(p->msg_slots),
+    rng(p->seed + p->core_id),
+    state(State::SETUP),
+    retryPkt(nullptr),
+    lastRead(0),
+    cmdKind(CmdKind::OP),
+    opsIssued(0),
+    opsDone(0),
+    burstOps(0),
+    nextPeer(0),
+    nextOpTick(0),
+    opStart(0),
+    opSize(0),
+    awaitingReply(false),
+    firstOpTick(MaxTick),
+    lastOpTick(0),
+    finished(numOps == 0)
+{
+    fatal_if(sizes.empty(), "%s: no message sizes given\n", name());
+    fatal_if(numOps > 0 && peers.empty(), "%s: no peers to generate traffic for\n", name());
+    fatal_if(pollInterval == 0, "%s: the poll interval has to be at least one cycle\n", name());
+
+    Addr maxSize = *std::max_element(sizes.begin(), sizes.end());
+    bool sends = command == Enums::send || command == Enums::send_reply;
+    fatal_if(sends && maxSize + sizeof(Dtu::MessageHeader) > slotSize,
+             "%s: messages of %lu bytes do not fit into slots of %lu bytes\n",
+             name(), maxSize, slotSize);
+
+    // the data area comes first, followed by the receive buffer and the reply buffer
+    dataAddr = p->buf_addr;
+    recvBufAddr = dataAddr + divCeil(maxSize, slotSize) * slotSize;
+    replyBufAddr = recvBufAddr + slots * slotSize;
+
+    if (!finished)
+        running++;
+
+    // kick things into action
+    schedule(tickEvent, curTick());
+}
+
+BaseMasterPort &
+DtuTrafficGen::getMasterPort(const std::string& if_name, PortID idx)
+{
+    if (if_name == "port")
+        return port;
+    else
+        return MemObject::getMasterPort(if_name, idx);
+}
+
+void
+DtuTrafficGen::regStats()
+{
+    MemObject::regStats();
+
+    ops
+        .name(name() + ".ops")
+        .desc("Number of finished operations");
+    failedOps
+        .name(name() + ".failedOps")
+        .desc("Number of operations the DTU reported an error for");
+    bytes
+        .name(name() + ".bytes")
+        .desc("Number of payload bytes transferred by successful operations");
+    receivedMsgs
+        .name(name() + ".receivedMsgs")
+        .desc("Number of messages received from other generators");
+    sentReplies
+        .name(name() + ".sentReplies")
+        .desc("Number of replies sent to other generators");
+    opLatency
+        .init(20)
+        .name(name() + ".opLatency")
+        .desc("Cycles from issuing an operation until its completion")
+        .flags(Stats::nozero);
+    latency50
+        .method(this, &DtuTrafficGen::latencyP50)
+        .name(name() + ".latency50")
+        .desc("Median latency of the operations in cycles");
+    latency90
+        .method(this, &DtuTrafficGen::latencyP90)
+        .name(name() + ".latency90")
+        .desc("90th percentile of the latency of the operations in cycles");
+    latency99
+        .method(this, &DtuTrafficGen::latencyP99)
+        .name(name() + ".latency99")
+        .desc("99th percentile of the latency of the operations in cycles");
+    bytesPerSec
+        .method(this, &DtuTrafficGen::throughput)
+        .name(name() + ".bytesPerSec")
+        .desc("Payload bytes per simulated second from the first to the last operation");
+}
+
+Addr
+DtuTrafficGen::regAddr(DtuReg reg) const
+{
+    return regFileBase + static_cast<Addr>(reg) * sizeof(RegFile::reg_t);
+}
+
+Addr
+DtuTrafficGen::regAddr(CmdReg reg) const
+{
+    return regFileBase + (numDtuRegs + static_cast<Addr>(reg)) * sizeof(RegFile::reg_t);
+}
+
+Addr
+DtuTrafficGen::regAddr(unsigned ep, EpReg reg) const
+{
+    Addr off = numDtuRegs + numCmdRegs + ep * numEpRegs + static_cast<Addr>(reg);
+    return regFileBase + off * sizeof(RegFile::reg_t);
+}
+
+void
+DtuTrafficGen::pushWrite(Addr addr, RegFile::reg_t value)
+{
+    accesses.push_back({addr, sizeof(RegFile::reg_t), value, true});
+}
+
+void
+DtuTrafficGen::pushRead(Addr addr, unsigned size)
+{
+    accesses.push_back({addr, size, 0, false});
+}
+
+void
+DtuTrafficGen::pushCommand(Dtu::CommandOpcode opcode, unsigned ep, CmdKind kind)
+{
+    RegFile::reg_t cmd = static_cast<RegFile::reg_t>(opcode);
+    cmd |= static_cast<RegFile::reg_t>(ep) << Dtu::numCmdOpcodeBits;
+    assert(ep < (1U << numCmdEpidBits));
+
+    pushWrite(regAddr(CmdReg::COMMAND), cmd);
+
+    cmdKind = kind;
+    state = State::WAIT_CMD;
+}
+
+void
+DtuTrafficGen::sleep(Cycles cycles)
+{
+    schedule(tickEvent, clockEdge(cycles));
+}
+
+void
+DtuTrafficGen::tick()
+{
+    if (accesses.empty())
+        step();
+
+    // step() either queued accesses or went to sleep
+    if (!accesses.empty())
+        sendAccess();
+}
+
+void
+DtuTrafficGen::step()
+{
+    switch (state)
+    {
+    case State::SETUP:
+    {
+        DPRINTF(DtuTrafficGen, "Setting up the endpoints\n");
+
+        // the receive buffer for the messages of the other generators
+        pushWrite(regAddr(RECV_EP, EpReg::BUF_ADDR), recvBufAddr);
+        pushWrite(regAddr(RECV_EP, EpReg::BUF_MSG_SIZE), slotSize);
+        pushWrite(regAddr(RECV_EP, EpReg::BUF_SIZE), slots);
+        pushWrite(regAddr(RECV_EP, EpReg::BUF_RD_PTR), recvBufAddr);
+        pushWrite(regAddr(RECV_EP, EpReg::BUF_WR_PTR), recvBufAddr);
+
+        // we wait for each reply before we send the next message, so that one slot suffices
+        pushWrite(regAddr(REPLY_EP, EpReg::BUF_ADDR), replyBufAddr);
+        pushWrite(regAddr(REPLY_EP, EpReg::BUF_MSG_SIZE), slotSize);
+        pushWrite(regAddr(REPLY_EP, EpReg::BUF_SIZE), 1);
+        pushWrite(regAddr(REPLY_EP, EpReg::BUF_RD_PTR), replyBufAddr);
+        pushWrite(regAddr(REPLY_EP, EpReg::BUF_WR_PTR), replyBufAddr);
+
+        // the target of the send EP is changed for every message; credits are not the point here
+        pushWrite(regAddr(SEND_EP, EpReg::TGT_EPID), RECV_EP);
+        pushWrite(regAddr(SEND_EP, EpReg::MAX_MSG_SIZE), slotSize);
+        pushWrite(regAddr(SEND_EP, EpReg::CREDITS), 1 << 30);
+
+        // the memory EP covers the data area of the peers
+        Addr maxSize = *std::max_element(sizes.begin(), sizes.end());
+        pushWrite(regAddr(MEM_EP, EpReg::REQ_REM_ADDR), dataAddr);
+        pushWrite(regAddr(MEM_EP, EpReg::REQ_REM_SIZE), maxSize);
+        pushWrite(regAddr(MEM_EP, EpReg::REQ_FLAGS), Dtu::READ | Dtu::WRITE);
+
+        state = State::IDLE;
+        break;
+    }
+
+    case State::IDLE:
+        pushRead(regAddr(DtuReg::MSG_CNT));
+        state = State::CHECK_MSGS;
+        break;
+
+    case State::CHECK_MSGS:
+        if (lastRead > 0)
+        {
+            // if we wait for a reply, it is probably the reply
+            if (awaitingReply)
+            {
+                pushRead(regAddr(REPLY_EP, EpReg::BUF_FETCH_MSG));
+                state = State::FETCHED_REPLY;
+            }
+            else
+            {
+                pushRead(regAddr(RECV_EP, EpReg::BUF_FETCH_MSG));
+                state = State::FETCHED_MSG;
+            }
+        }
+        else
+            nextOp();
+        break;
+
+    case State::FETCHED_REPLY:
+        if (lastRead != 0)
+        {
+            DPRINTF(DtuTrafficGen, "Received reply at %#x\n", lastRead);
+
+            awaitingReply = false;
+            finishOp(false);
+            pushCommand(Dtu::CommandOpcode::INC_READ_PTR, REPLY_EP, CmdKind::ACK);
+        }
+        else
+        {
+            pushRead(regAddr(RECV_EP, EpReg::BUF_FETCH_MSG));
+            state = State::FETCHED_MSG;
+        }
+        break;
+
+    case State::FETCHED_MSG:
+        if (lastRead != 0)
+        {
+            pushRead(lastRead + offsetof(Dtu::MessageHeader, label));
+            state = State::READ_LABEL;
+        }
+        else
+            nextOp();
+        break;
+
+    case State::READ_LABEL:
+        receivedMsgs++;
+
+        DPRINTF(DtuTrafficGen, "Received message with label %#x\n", lastRead);
+
+        // the DTU replies to the message at the read pointer, which is the one we just fetched
+        if (lastRead & WANT_REPLY)
+        {
+            pushWrite(regAddr(CmdReg::DATA_ADDR), dataAddr);
+            pushWrite(regAddr(CmdReg::DATA_SIZE), lastRead & ~WANT_REPLY);
+            pushCommand(Dtu::CommandOpcode::REPLY, RECV_EP, CmdKind::REPLY);
+        }
+        else
+            pushCommand(Dtu::CommandOpcode::INC_READ_PTR, RECV_EP, CmdKind::ACK);
+        break;
+
+    case State::WAIT_CMD:
+        pushRead(regAddr(DtuReg::CMD_BUSY));
+        state = State::CHECK_CMD;
+        break;
+
+    case State::CHECK_CMD:
+        if (lastRead != 0)
+        {
+            state = State::WAIT_CMD;
+            sleep(pollInterval);
+        }
+        else
+        {
+            pushRead(regAddr(DtuReg::CMD_ERROR));
+            state = State::CMD_DONE;
+        }
+        break;
+
+    case State::CMD_DONE:
+    {
+        bool failed = lastRead != 0;
+        if (failed)
+        {
+            DPRINTF(DtuTrafficGen, "Command failed with %#x\n", lastRead);
+
+            // acknowledge the error
+            pushWrite(regAddr(DtuReg::CMD_ERROR), 0);
+        }
+
+        state = State::IDLE;
+
+        switch (cmdKind)
+        {
+        case CmdKind::OP:
+            if (!failed && command == Enums::send_reply)
+                awaitingReply = true;
+            else
+                finishOp(failed);
+            break;
+
+        case CmdKind::REPLY:
+            if (!failed)
+                sentReplies++;
+            pushCommand(Dtu::CommandOpcode::INC_READ_PTR, RECV_EP, CmdKind::ACK);
+            break;
+
+        case CmdKind::ACK:
+            break;
+        }
+
+        // nothing to wait for, so look for messages right away
+        if (accesses.empty())
+            step();
+        break;
+    }
+    }
+}
+
+unsigned
+DtuTrafficGen::chooseTarget()
+{
+    switch (pattern)
+    {
+    case Enums::hotspot:
+        if (rng() % 100 < hotspotPercent)
+            return hotspot;
+        // fall through
+    default:
+    case Enums::uniform:
+        return peers[rng() % peers.size()];
+
+    case Enums::all_to_all:
+    {
+        unsigned target = peers[nextPeer];
+        nextPeer = (nextPeer + 1) % peers.size();
+        return target;
+    }
+    }
+}
+
+void
+DtuTrafficGen::nextOp()
+{
+    state = State::IDLE;
+
+    // without something to issue, we just serve the messages of the others
+    if (opsIssued == numOps || awaitingReply)
+    {
+        sleep(pollInterval);
+        return;
+    }
+
+    if (curTick() < nextOpTick)
+    {
+        sleep(std::min(pollInterval, ticksToCycles(nextOpTick - curTick())));
+        return;
+    }
+
+    unsigned target = chooseTarget();
+    opSize = sizes[rng() % sizes.size()];
+    opStart = curTick();
+    if (firstOpTick == MaxTick)
+        firstOpTick = opStart;
+    opsIssued++;
+
+    DPRINTF(DtuTrafficGen, "Starting %s #%u of %lu bytes with PE%u\n",
+            Enums::DtuTrafficCommandStrings[command], opsIssued, opSize, target);
+
+    switch (command)
+    {
+    case Enums::send:
+    case Enums::send_reply:
+        pushWrite(regAddr(SEND_EP, EpReg::TGT_COREID), target);
+        pushWrite(regAddr(SEND_EP, EpReg::LABEL),
+                  command == Enums::send_reply ? WANT_REPLY | opSize : 0);
+        pushWrite(regAddr(CmdReg::DATA_ADDR), dataAddr);
+        pushWrite(regAddr(CmdReg::DATA_SIZE), opSize);
+        pushWrite(regAddr(CmdReg::REPLY_EPID), REPLY_EP);
+        pushWrite(regAddr(CmdReg::REPLY_LABEL), 0);
+        pushCommand(Dtu::CommandOpcode::SEND, SEND_EP, CmdKind::OP);
+        break;
+
+    case Enums::read:
+    case Enums::write:
+        pushWrite(regAddr(MEM_EP, EpReg::TGT_COREID), target);
+        pushWrite(regAddr(CmdReg::DATA_ADDR), dataAddr);
+        pushWrite(regAddr(CmdReg::DATA_SIZE), opSize);
+        pushWrite(regAddr(CmdReg::OFFSET), 0);
+        pushCommand(command == Enums::read ? Dtu::CommandOpcode::READ
+                                           : Dtu::CommandOpcode::WRITE,
+                    MEM_EP, CmdKind::OP);
+        break;
+
+    default:
+        panic("Unexpected command %d\n", command);
+    }
+
+    // pause after each burst
+    Cycles gap = opGap;
+    if (burstLength > 0 && ++burstOps == burstLength)
+    {
+        burstOps = 0;
+        gap = burstGap;
+    }
+    nextOpTick = clockEdge(gap);
+}
+
+void
+DtuTrafficGen::finishOp(bool failed)
+{
+    Cycles latency = ticksToCycles(curTick() - opStart);
+
+    ops++;
+    if (failed)
+        failedOps++;
+    else
+    {
+        bytes += opSize;
+        opLatency.sample(latency);
+        latencies.push_back(latency);
+    }
+
+    opsDone++;
+    lastOpTick = curTick();
+
+    if (opsDone == numOps)
+        finish();
+}
+
+void
+DtuTrafficGen::finish()
+{
+    assert(!finished);
+    finished = true;
+
+    inform("%s: %u operations (%u failed), %.0f bytes/s, latency p50=%.0f p90=%.0f p99=%.0f"
+           " cycles\n",
+           name(), opsDone, static_cast<unsigned>(failedOps.value()), throughput(),
+           latencyP50(), latencyP90(), latencyP99());
+
+    // we keep serving the messages of the others; the simulation ends with the last generator
+    if (--running == 0)
+        exitSimLoop("all DTU traffic generators finished");
+}
+
+double
+DtuTrafficGen::latencyPercentile(double p) const
+{
+    if (latencies.empty())
+        return 0;
+
+    std::vector<Tick> sorted(latencies);
+    size_t idx = std::min(sorted.size() - 1,
+                          static_cast<size_t>(p / 100 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+}
+
+double
+DtuTrafficGen::throughput() const
+{
+    if (lastOpTick <= firstOpTick || firstOpTick == MaxTick)
+        return 0;
+
+    return bytes.value() / ((lastOpTick - firstOpTick) / SimClock::Float::s);
+}
+
+void
+DtuTrafficGen::sendAccess()
+{
+    assert(!retryPkt);
+
+    const Access &acc = accesses.front();
+
+    Request::Flags flags;
+    auto req = new Request(acc.addr, acc.size, flags, masterId);
+    req->setThreadContext(coreId, 0);
+
+    auto pkt = new Packet(req, acc.write ? MemCmd::WriteReq : MemCmd::ReadReq);
+    auto data = new uint8_t[acc.size]();
+    memcpy(data, &acc.value, std::min<size_t>(acc.size, sizeof(acc.value)));
+    pkt->dataDynamic(data);
+
+    DPRINTF(DtuTrafficGen, "%s %#x (%u bytes)\n",
+            acc.write ? "Writing" : "Reading", acc.addr, acc.size);
+
+    if (atomic)
+    {
+        port.sendAtomic(pkt);
+        completeAccess(pkt);
+    }
+    else if (!port.sendTimingReq(pkt))
+        retryPkt = pkt;
+}
+
+void
+DtuTrafficGen::completeAccess(PacketPtr pkt)
+{
+    if (pkt->isError())
+    {
+        panic("%s: %s at %#x failed\n", name(),
+              pkt->isWrite() ? "write" : "read", pkt->getAddr());
+    }
+
+    if (pkt->isRead())
+    {
+        lastRead = 0;
+        memcpy(&lastRead, pkt->getConstPtr<uint8_t>(),
+               std::min<size_t>(pkt->getSize(), sizeof(lastRead)));
+    }
+
+    accesses.pop_front();
+
+    delete pkt->req;
+    // the packet will delete the data
+    delete pkt;
+
+    schedule(tickEvent, clockEdge(Cycles(1)));
+}
+
+DtuTrafficGen*
+DtuTrafficGenParams::create()
+{
+    return new DtuTrafficGen(this);
+}
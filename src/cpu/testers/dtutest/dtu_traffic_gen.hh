@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __CPU_DTUTEST_DTU_TRAFFIC_GEN_HH__
+#define __CPU_DTUTEST_DTU_TRAFFIC_GEN_HH__
+
+#include <atomic>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "enums/DtuTrafficCommand.hh"
+#include "enums/DtuTrafficPattern.hh"
+#include "mem/dtu/dtu.hh"
+#include "mem/dtu/regfile.hh"
+#include "mem/mem_object.hh"
+#include "params/DtuTrafficGen.hh"
+
+/**
+ * A traffic generator that sits in place of the CPU of a PE and drives the DTU like software
+ * would: it programs endpoints through the register file, issues SEND, READ or WRITE commands to
+ * a set of peers according to a pattern, and serves the messages it receives (including replies
+ * if the sender asked for them). Only one command is in flight at a time, because the generator
+ * waits for the completion by polling the DTU registers.
+ *
+ * The latency of a command is measured from its first register write until the generator
+ * observes its completion or, for SEND with reply, the reply.
+ */
+class DtuTrafficGen : public MemObject
+{
+  public:
+
+    DtuTrafficGen(const DtuTrafficGenParams *p);
+
+    BaseMasterPort& getMasterPort(const std::string &if_name,
+                                  PortID idx = InvalidPortID) override;
+
+    void regStats() override;
+
+  private:
+
+    // the endpoints we use on every PE
+    static const unsigned SEND_EP   = 0;
+    static const unsigned RECV_EP   = 1;
+    static const unsigned REPLY_EP  = 2;
+    static const unsigned MEM_EP    = 3;
+
+    // set in the label of messages that want a reply of the size in the lower bits
+    static const uint64_t WANT_REPLY = static_cast<uint64_t>(1) << 63;
+
+    enum class State
+    {
+        SETUP,
+        IDLE,
+        CHECK_MSGS,
+        FETCHED_REPLY,
+        FETCHED_MSG,
+        READ_LABEL,
+        WAIT_CMD,
+        CHECK_CMD,
+        CMD_DONE,
+    };
+
+    // what the command we are waiting for has been issued for
+    enum class CmdKind
+    {
+        OP,
+        REPLY,
+        ACK,
+    };
+
+    struct Access
+    {
+        Addr addr;
+        unsigned size;
+        RegFile::reg_t value;
+        bool write;
+    };
+
+    class CpuPort : public MasterPort
+    {
+      private:
+        DtuTrafficGen& gen;
+      public:
+        CpuPort(const std::string& _name, DtuTrafficGen* _gen)
+            : MasterPort(_name, _gen), gen(*_gen)
+        { }
+      protected:
+        bool recvTimingResp(PacketPtr pkt) override;
+
+        void recvReqRetry() override;
+    };
+
+    void tick();
+
+    void step();
+
+    void sleep(Cycles cycles);
+
+    void nextOp();
+
+    void finishOp(bool failed);
+
+    void finish();
+
+    unsigned chooseTarget();
+
+    Addr regAddr(DtuReg reg) const;
+
+    Addr regAddr(CmdReg reg) const;
+
+    Addr regAddr(unsigned ep, EpReg reg) const;
+
+    void pushWrite(Addr addr, RegFile::reg_t value);
+
+    void pushRead(Addr addr, unsigned size = sizeof(RegFile::reg_t));
+
+    void pushCommand(Dtu::CommandOpcode opcode, unsigned ep, CmdKind kind);
+
+    void sendAccess();
+
+    void completeAccess(PacketPtr pkt);
+
+    double latencyPercentile(double p) const;
+
+    double latencyP50() const { return latencyPercentile(50); }
+    double latencyP90() const { return latencyPercentile(90); }
+    double latencyP99() const { return latencyPercentile(99); }
+
+    double throughput() const;
+
+  private:
+
+    EventWrapper<DtuTrafficGen, &DtuTrafficGen::tick> tickEvent;
+
+    CpuPort port;
+
+    MasterID masterId;
+
+    const bool atomic;
+
+    const unsigned coreId;
+
+    const Addr regFileBase;
+
+    const unsigned numCmdEpidBits;
+
+    const std::vector<unsigned> peers;
+
+    const Enums::DtuTrafficPattern pattern;
+
+    const unsigned hotspot;
+
+    const unsigned hotspotPercent;
+
+    const Enums::DtuTrafficCommand command;
+
+    const std::vector<Addr> sizes;
+
+    const unsigned numOps;
+
+    const Cycles opGap;
+
+    const unsigned burstLength;
+
+    const Cycles burstGap;
+
+    const Cycles pollInterval;
+
+    const Addr slotSize;
+
+    const unsigned slots;
+
+    // the local buffers: the data that is sent or read/written and the receive buffers
+    Addr dataAddr;
+    Addr recvBufAddr;
+    Addr replyBufAddr;
+
+    std::mt19937 rng;
+
+    State state;
+
+    std::deque<Access> accesses;
+
+    // the access that could not be sent and waits for a retry
+    PacketPtr retryPkt;
+
+    RegFile::reg_t lastRead;
+
+    CmdKind cmdKind;
+
+    unsigned opsIssued;
+
+    unsigned opsDone;
+
+    unsigned burstOps;
+
+    unsigned nextPeer;
+
+    Tick nextOpTick;
+
+    Tick opStart;
+
+    Addr opSize;
+
+    bool awaitingReply;
+
+    Tick firstOpTick;
+
+    Tick lastOpTick;
+
+    bool finished;
+
+    // the latencies of all finished operations in cycles
+    std::vector<Tick> latencies;
+
+    // the number of generators that still have commands to issue
+    static std::atomic<unsigned> running;
+
+    Stats::Scalar ops;
+    Stats::Scalar failedOps;
+    Stats::Scalar bytes;
+    Stats::Scalar receivedMsgs;
+    Stats::Scalar sentReplies;
+    Stats::Histogram opLatency;
+    Stats::Value latency50;
+    Stats::Value latency90;
+    Stats::Value latency99;
+    Stats::Value bytesPerSec;
+};
+
+#endif // __CPU_DTUTEST_DTU_TRAFFIC_GEN_HH__
@@ -85,6 +85,13 @@ class BaseXBar(MemObject):
     use_default_range = Param.Bool(False, "Perform address mapping for " \
                                        "the default port")
 
+    # Ranges that cover whole, aligned chunks of 2^decode_shift bytes
+    # are decoded with a direct-indexed table in front of the address
+    # map. This is useful for crossbars that route by the upper address
+    # bits, where the small cache in front of the map keeps missing.
+    decode_shift = Param.Unsigned(0, "Log2 of the chunk size for the " \
+                                      "decode table (0 = disabled)")
+
 class NoncoherentXBar(BaseXBar):
     type = 'NoncoherentXBar'
     cxx_header = "mem/noncoherent_xbar.hh"
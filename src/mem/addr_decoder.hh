@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __MEM_ADDR_DECODER_HH__
+#define __MEM_ADDR_DECODER_HH__
+
+#include <vector>
+
+#include "base/addr_range_map.hh"
+#include "base/types.hh"
+
+/**
+ * A direct-indexed decode table for crossbars that route by the upper
+ * address bits. The address space is divided into aligned chunks of
+ * 2^shift bytes and every chunk that is completely covered by a single
+ * (non-interleaved) range of the port map holds the id of its port.
+ * All other chunks, and chunks beyond the table size, hold
+ * InvalidPortID, in which case the caller falls back to the port map.
+ *
+ * For the DTU NoC, where each PE responds to the addresses with its
+ * core id in the upper byte, this turns the lookup into a single
+ * array access, independent of the number of PEs.
+ */
+class AddrDecoder
+{
+  public:
+
+    /**
+     * @param _shift the log2 of the chunk size (0 disables the table)
+     * @param _maxChunks the maximum number of table entries
+     */
+    AddrDecoder(unsigned _shift, size_t _maxChunks = 4096)
+        : shift(_shift), maxChunks(_maxChunks), table()
+    {}
+
+    bool enabled() const { return shift != 0; }
+
+    /**
+     * Rebuilds the table from the given port map. Needs to be called
+     * whenever the map changes.
+     */
+    void build(const AddrRangeMap<PortID> &map)
+    {
+        table.clear();
+        if (!enabled())
+            return;
+
+        const Addr mask = (static_cast<Addr>(1) << shift) - 1;
+        for (const auto &r : map) {
+            if (r.first.interleaved())
+                continue;
+
+            // determine the chunks that are completely within the range
+            Addr first = (r.first.start() >> shift) +
+                         ((r.first.start() & mask) ? 1 : 0);
+            Addr last = r.first.end() >> shift;
+            if ((r.first.end() & mask) != mask) {
+                if (last == 0)
+                    continue;
+                last--;
+            }
+            if (first > last || first >= maxChunks)
+                continue;
+            if (last >= maxChunks)
+                last = maxChunks - 1;
+
+            if (table.size() <= last)
+                table.resize(last + 1, InvalidPortID);
+            for (Addr c = first; c <= last; ++c)
+                table[c] = r.second;
+        }
+    }
+
+    /**
+     * @return the port for the given address or InvalidPortID if the
+     *  port map needs to be consulted
+     */
+    PortID lookup(Addr addr) const
+    {
+        Addr chunk = addr >> shift;
+        if (chunk < table.size())
+            return table[chunk];
+        return InvalidPortID;
+    }
+
+  private:
+
+    const unsigned shift;
+    const size_t maxChunks;
+    std::vector<PortID> table;
+};
+
+#endif
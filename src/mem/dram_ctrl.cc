@@ -43,6 +43,8 @@
  *          Omar Naji
  */
 
+#include <algorithm>
+
 #include "base/bitfield.hh"
 #include "base/trace.hh"
 #include "debug/DRAM.hh"
@@ -128,6 +130,9 @@ DRAMCtrl::DRAMCtrl(const DRAMCtrlParams* p) :
         }
     }
 
+    readQueue.init(ranksPerChannel * banksPerRank);
+    writeQueue.init(ranksPerChannel * banksPerRank);
+
     // perform a basic check of the write thresholds
     if (p->write_low_thresh_perc >= p->write_high_thresh_perc)
         fatal("Write buffer low threshold %d must be smaller than the "
@@ -443,19 +448,18 @@ DRAMCtrl::addToReadQueue(PacketPtr pkt, unsigned int pktCount)
         Addr burst_addr = burstAlign(addr);
         // if the burst address is not present then there is no need
         // looking any further
-        if (isInWriteQueue.find(burst_addr) != isInWriteQueue.end()) {
-            for (const auto& p : writeQueue) {
-                // check if the read is subsumed in the write queue
-                // packet we are looking at
-                if (p->addr <= addr && (addr + size) <= (p->addr + p->size)) {
-                    foundInWrQ = true;
-                    servicedByWrQ++;
-                    pktsServicedByWrQ++;
-                    DPRINTF(DRAM, "Read to addr %lld with size %d serviced by "
-                            "write queue\n", addr, size);
-                    bytesReadWrQ += burstSize;
-                    break;
-                }
+        auto w = isInWriteQueue.find(burst_addr);
+        if (w != isInWriteQueue.end()) {
+            // check if the read is subsumed in the write queue packet
+            // to the same burst, as no other one can contain it
+            const DRAMPacket* p = w->second;
+            if (p->addr <= addr && (addr + size) <= (p->addr + p->size)) {
+                foundInWrQ = true;
+                servicedByWrQ++;
+                pktsServicedByWrQ++;
+                DPRINTF(DRAM, "Read to addr %lld with size %d serviced by "
+                        "write queue\n", addr, size);
+                bytesReadWrQ += burstSize;
             }
         }
 
@@ -538,7 +542,7 @@ DRAMCtrl::addToWriteQueue(PacketPtr pkt, unsigned int pktCount)
             DPRINTF(DRAM, "Adding to write queue\n");
 
             writeQueue.push_back(dram_pkt);
-            isInWriteQueue.insert(burstAlign(addr));
+            isInWriteQueue[burstAlign(addr)] = dram_pkt;
             assert(writeQueue.size() == isInWriteQueue.size());
 
             // Update stats
@@ -573,16 +577,22 @@ DRAMCtrl::addToWriteQueue(PacketPtr pkt, unsigned int pktCount)
 void
 DRAMCtrl::printQs() const {
     DPRINTF(DRAM, "===READ QUEUE===\n\n");
-    for (auto i = readQueue.begin() ;  i != readQueue.end() ; ++i) {
-        DPRINTF(DRAM, "Read %lu\n", (*i)->addr);
+    for (unsigned int b = 0; b < readQueue.numBanks(); ++b) {
+        for (const auto& r : readQueue.bank(b).rows) {
+            for (const auto& p : r.second)
+                DPRINTF(DRAM, "Read %lu\n", p->addr);
+        }
     }
     DPRINTF(DRAM, "\n===RESP QUEUE===\n\n");
     for (auto i = respQueue.begin() ;  i != respQueue.end() ; ++i) {
         DPRINTF(DRAM, "Response %lu\n", (*i)->addr);
     }
     DPRINTF(DRAM, "\n===WRITE QUEUE===\n\n");
-    for (auto i = writeQueue.begin() ;  i != writeQueue.end() ; ++i) {
-        DPRINTF(DRAM, "Write %lu\n", (*i)->addr);
+    for (unsigned int b = 0; b < writeQueue.numBanks(); ++b) {
+        for (const auto& r : writeQueue.bank(b).rows) {
+            for (const auto& p : r.second)
+                DPRINTF(DRAM, "Write %lu\n", p->addr);
+        }
     }
 }
 
@@ -709,141 +719,185 @@ DRAMCtrl::processRespondEvent()
     }
 }
 
-bool
-DRAMCtrl::chooseNext(std::deque<DRAMPacket*>& queue, Tick extra_col_delay)
+size_t
+DRAMCtrl::DRAMQueue::BankQueue::countTo(uint32_t row) const
 {
-    // This method does the arbitration between requests. The chosen
-    // packet is simply moved to the head of the queue. The other
-    // methods know that this is the place to look. For example, with
-    // FCFS, this method does nothing
-    assert(!queue.empty());
+    auto r = rows.find(row);
+    return r == rows.end() ? 0 : r->second.size();
+}
 
-    // bool to indicate if a packet to an available rank is found
-    bool found_packet = false;
-    if (queue.size() == 1) {
-        DRAMPacket* dram_pkt = queue.front();
-        // available rank corresponds to state refresh idle
-        if (ranks[dram_pkt->rank]->isAvailable()) {
-            found_packet = true;
-            DPRINTF(DRAM, "Single request, going to a free rank\n");
-        } else {
-            DPRINTF(DRAM, "Single request, going to a busy rank\n");
-        }
-        return found_packet;
+DRAMCtrl::DRAMPacket*
+DRAMCtrl::DRAMQueue::BankQueue::oldestTo(uint32_t row) const
+{
+    auto r = rows.find(row);
+    return r == rows.end() ? NULL : r->second.front();
+}
+
+DRAMCtrl::DRAMPacket*
+DRAMCtrl::DRAMQueue::BankQueue::oldestNotTo(uint32_t row) const
+{
+    DRAMPacket* oldest = NULL;
+    for (const auto& r : rows) {
+        if (r.first != row && r.second.front()->olderThan(oldest))
+            oldest = r.second.front();
     }
+    return oldest;
+}
+
+void
+DRAMCtrl::DRAMQueue::push_back(DRAMPacket* dram_pkt)
+{
+    dram_pkt->seqNum = nextSeqNum++;
+    BankQueue& bank = banks[dram_pkt->bankId];
+    bank.rows[dram_pkt->row].push_back(dram_pkt);
+    bank.count++;
+    count++;
+}
+
+void
+DRAMCtrl::DRAMQueue::remove(DRAMPacket* dram_pkt)
+{
+    BankQueue& bank = banks[dram_pkt->bankId];
+    auto r = bank.rows.find(dram_pkt->row);
+    assert(r != bank.rows.end());
+
+    // the scheduler always picks the oldest request to a row
+    RowQueue& row = r->second;
+    if (row.front() == dram_pkt) {
+        row.pop_front();
+    } else {
+        auto p = std::find(row.begin(), row.end(), dram_pkt);
+        assert(p != row.end());
+        row.erase(p);
+    }
+
+    if (row.empty())
+        bank.rows.erase(r);
+    bank.count--;
+    count--;
+}
+
+DRAMCtrl::DRAMPacket*
+DRAMCtrl::chooseNext(const DRAMQueue& queue, Tick extra_col_delay)
+{
+    // This method does the arbitration between requests. The chosen
+    // packet is returned, but stays in the queue until the caller has
+    // dealt with it. With FCFS, this is simply the oldest packet to an
+    // available rank.
+    assert(!queue.empty());
 
+    DRAMPacket* selected_pkt = NULL;
     if (memSchedPolicy == Enums::fcfs) {
-        // check if there is a packet going to a free rank
-        for(auto i = queue.begin(); i != queue.end() ; ++i) {
-            DRAMPacket* dram_pkt = *i;
-            if (ranks[dram_pkt->rank]->isAvailable()) {
-                queue.erase(i);
-                queue.push_front(dram_pkt);
-                found_packet = true;
-                break;
-            }
+        // look at the oldest packet of each bank to a free rank
+        for (uint16_t b = 0; b < queue.numBanks(); ++b) {
+            if (queue.bank(b).count == 0 ||
+                !ranks[b / banksPerRank]->isAvailable())
+                continue;
+
+            DRAMPacket* dram_pkt = queue.bank(b).oldestNotTo(Bank::NO_ROW);
+            if (dram_pkt->olderThan(selected_pkt))
+                selected_pkt = dram_pkt;
         }
     } else if (memSchedPolicy == Enums::frfcfs) {
-        found_packet = reorderQueue(queue, extra_col_delay);
+        selected_pkt = reorderQueue(queue, extra_col_delay);
     } else
         panic("No scheduling policy chosen\n");
-    return found_packet;
+
+    if (selected_pkt == NULL)
+        DPRINTF(DRAM, "No request to a free rank\n");
+    return selected_pkt;
 }
 
-bool
-DRAMCtrl::reorderQueue(std::deque<DRAMPacket*>& queue, Tick extra_col_delay)
+DRAMCtrl::DRAMPacket*
+DRAMCtrl::reorderQueue(const DRAMQueue& queue, Tick extra_col_delay)
 {
-    // Only determine this if needed
-    uint64_t earliest_banks = 0;
-    bool hidden_bank_prep = false;
-
     // search for seamless row hits first, if no seamless row hit is
     // found then determine if there are other packets that can be issued
     // without incurring additional bus delay due to bank timing
     // Will select closed rows first to enable more open row possibilies
-    // in future selections
-    bool found_hidden_bank = false;
+    // in future selections. Within each of these classes, the oldest
+    // packet wins, which is the packet that a scan through the queue in
+    // arrival order would find first.
 
-    // remember if we found a row hit, not seamless, but bank prepped
-    // and ready
-    bool found_prepped_pkt = false;
+    // the oldest row hit that can issue seamlessly
+    DRAMPacket* seamless_pkt = NULL;
 
-    // if we have no row hit, prepped or not, and no seamless packet,
-    // just go for the earliest possible
-    bool found_earliest_pkt = false;
+    // the oldest row hit, not seamless, but bank prepped and ready
+    DRAMPacket* prepped_pkt = NULL;
 
-    auto selected_pkt_it = queue.end();
+    // whether there are any packets to a row that is not open
+    bool got_row_miss = false;
 
     // time we need to issue a column command to be seamless
     const Tick min_col_at = std::max(busBusyUntil - tCL + extra_col_delay,
                                      curTick());
 
-    for (auto i = queue.begin(); i != queue.end() ; ++i) {
-        DRAMPacket* dram_pkt = *i;
-        const Bank& bank = dram_pkt->bankRef;
-
-        // check if rank is available, if not, jump to the next packet
-        if (dram_pkt->rankRef.isAvailable()) {
-            // check if it is a row hit
-            if (bank.openRow == dram_pkt->row) {
-                // no additional rank-to-rank or same bank-group
-                // delays, or we switched read/write and might as well
-                // go for the row hit
-                if (bank.colAllowedAt <= min_col_at) {
-                    // FCFS within the hits, giving priority to
-                    // commands that can issue seamlessly, without
-                    // additional delay, such as same rank accesses
-                    // and/or different bank-group accesses
-                    DPRINTF(DRAM, "Seamless row buffer hit\n");
-                    selected_pkt_it = i;
-                    // no need to look through the remaining queue entries
-                    break;
-                } else if (!found_hidden_bank && !found_prepped_pkt) {
-                    // if we did not find a packet to a closed row that can
-                    // issue the bank commands without incurring delay, and
-                    // did not yet find a packet to a prepped row, remember
-                    // the current one
-                    selected_pkt_it = i;
-                    found_prepped_pkt = true;
-                    DPRINTF(DRAM, "Prepped row buffer hit\n");
-                }
-            } else if (!found_earliest_pkt) {
-                // if we have not initialised the bank status, do it
-                // now, and only once per scheduling decisions
-                if (earliest_banks == 0) {
-                    // determine entries with earliest bank delay
-                    pair<uint64_t, bool> bankStatus =
-                        minBankPrep(queue, min_col_at);
-                    earliest_banks = bankStatus.first;
-                    hidden_bank_prep = bankStatus.second;
-                }
-
-                // bank is amongst first available banks
-                // minBankPrep will give priority to packets that can
-                // issue seamlessly
-                if (bits(earliest_banks, dram_pkt->bankId, dram_pkt->bankId)) {
-                    found_earliest_pkt = true;
-                    found_hidden_bank = hidden_bank_prep;
-
-                    // give priority to packets that can issue
-                    // bank commands 'behind the scenes'
-                    // any additional delay if any will be due to
-                    // col-to-col command requirements
-                    if (hidden_bank_prep || !found_prepped_pkt)
-                        selected_pkt_it = i;
-                }
+    for (uint16_t b = 0; b < queue.numBanks(); ++b) {
+        const DRAMQueue::BankQueue& bank_queue = queue.bank(b);
+        const Rank& rank = *ranks[b / banksPerRank];
+
+        // check if rank is available, if not, jump to the next bank
+        if (bank_queue.count == 0 || !rank.isAvailable())
+            continue;
+
+        const Bank& bank = rank.banks[b % banksPerRank];
+        DRAMPacket* hit_pkt = bank_queue.oldestTo(bank.openRow);
+        if (hit_pkt) {
+            // no additional rank-to-rank or same bank-group
+            // delays, or we switched read/write and might as well
+            // go for the row hit
+            if (bank.colAllowedAt <= min_col_at) {
+                if (hit_pkt->olderThan(seamless_pkt))
+                    seamless_pkt = hit_pkt;
+            } else if (hit_pkt->olderThan(prepped_pkt)) {
+                prepped_pkt = hit_pkt;
             }
         }
+
+        got_row_miss |= bank_queue.countTo(bank.openRow) < bank_queue.count;
     }
 
-    if (selected_pkt_it != queue.end()) {
-        DRAMPacket* selected_pkt = *selected_pkt_it;
-        queue.erase(selected_pkt_it);
-        queue.push_front(selected_pkt);
-        return true;
+    // FCFS within the hits, giving priority to commands that can issue
+    // seamlessly, without additional delay, such as same rank accesses
+    // and/or different bank-group accesses
+    if (seamless_pkt) {
+        DPRINTF(DRAM, "Seamless row buffer hit\n");
+        return seamless_pkt;
     }
 
-    return false;
+    // if we have no row hit, prepped or not, and no seamless packet,
+    // just go for the earliest possible
+    DRAMPacket* earliest_pkt = NULL;
+    bool hidden_bank_prep = false;
+    if (got_row_miss) {
+        // determine entries with earliest bank delay
+        pair<uint64_t, bool> bankStatus = minBankPrep(queue, min_col_at);
+        uint64_t earliest_banks = bankStatus.first;
+        hidden_bank_prep = bankStatus.second;
+
+        // take the oldest miss amongst the first available banks
+        // minBankPrep will give priority to packets that can
+        // issue seamlessly
+        for (uint16_t b = 0; b < queue.numBanks(); ++b) {
+            if (!bits(earliest_banks, b, b))
+                continue;
+
+            const Bank& bank = ranks[b / banksPerRank]->banks[b % banksPerRank];
+            DRAMPacket* miss_pkt = queue.bank(b).oldestNotTo(bank.openRow);
+            if (miss_pkt && miss_pkt->olderThan(earliest_pkt))
+                earliest_pkt = miss_pkt;
+        }
+    }
+
+    // give priority to packets that can issue bank commands 'behind the
+    // scenes' any additional delay if any will be due to col-to-col
+    // command requirements
+    if (earliest_pkt && (hidden_bank_prep || !prepped_pkt))
+        return earliest_pkt;
+
+    if (prepped_pkt)
+        DPRINTF(DRAM, "Prepped row buffer hit\n");
+    return prepped_pkt;
 }
 
 void
@@ -1146,30 +1200,21 @@ DRAMCtrl::doDRAMAccess(DRAMPacket* dram_pkt)
         // page, but closes it only if there are no row hits in the queue.
         // In this case, only force an auto precharge when there
         // are no same page hits in the queue
-        bool got_more_hits = false;
-        bool got_bank_conflict = false;
 
         // either look at the read queue or write queue
-        const deque<DRAMPacket*>& queue = dram_pkt->isRead ? readQueue :
-            writeQueue;
-        auto p = queue.begin();
-        // make sure we are not considering the packet that we are
-        // currently dealing with (which is the head of the queue)
-        ++p;
-
-        // keep on looking until we find a hit or reach the end of the queue
-        // 1) if a hit is found, then both open and close adaptive policies keep
-        // the page open
-        // 2) if no hit is found, got_bank_conflict is set to true if a bank
-        // conflict request is waiting in the queue
-        while (!got_more_hits && p != queue.end()) {
-            bool same_rank_bank = (dram_pkt->rank == (*p)->rank) &&
-                (dram_pkt->bank == (*p)->bank);
-            bool same_row = dram_pkt->row == (*p)->row;
-            got_more_hits |= same_rank_bank && same_row;
-            got_bank_conflict |= same_rank_bank && !same_row;
-            ++p;
-        }
+        const DRAMQueue& queue = dram_pkt->isRead ? readQueue : writeQueue;
+        const DRAMQueue::BankQueue& bank_queue = queue.bank(dram_pkt->bankId);
+
+        // the packet that we are currently dealing with is still in the
+        // queue, so do not consider it
+        // 1) if there is another hit, then both open and close adaptive
+        // policies keep the page open
+        // 2) if not, got_bank_conflict is set to true if a bank conflict
+        // request is waiting in the queue
+        size_t row_pkts = bank_queue.countTo(dram_pkt->row);
+        assert(row_pkts > 0);
+        bool got_more_hits = row_pkts > 1;
+        bool got_bank_conflict = bank_queue.count > row_pkts;
 
         // auto pre-charge when either
         // 1) open_adaptive policy, we have not got any more hits, and
@@ -1313,25 +1358,20 @@ DRAMCtrl::processNextReqEvent()
                 return;
             }
         } else {
-            // bool to check if there is a read to a free rank
-            bool found_read = false;
-
-            // Figure out which read request goes next, and move it to the
-            // front of the read queue
+            // Figure out which read request goes next
             // If we are changing command type, incorporate the minimum
             // bus turnaround delay which will be tCS (different rank) case
-            found_read = chooseNext(readQueue,
-                             switched_cmd_type ? tCS : 0);
+            DRAMPacket* dram_pkt = chooseNext(readQueue,
+                                              switched_cmd_type ? tCS : 0);
 
             // if no read to an available rank is found then return
             // at this point. There could be writes to the available ranks
             // which are above the required threshold. However, to
             // avoid adding more complexity to the code, return and wait
             // for a refresh event to kick things into action again.
-            if (!found_read)
+            if (dram_pkt == NULL)
                 return;
 
-            DRAMPacket* dram_pkt = readQueue.front();
             assert(dram_pkt->rankRef.isAvailable());
             // here we get a bit creative and shift the bus busy time not
             // just the tWTR, but also a CAS latency to capture the fact
@@ -1345,7 +1385,7 @@ DRAMCtrl::processNextReqEvent()
             doDRAMAccess(dram_pkt);
 
             // At this point we're done dealing with the request
-            readQueue.pop_front();
+            readQueue.remove(dram_pkt);
 
             // sanity check
             assert(dram_pkt->size <= burstSize);
@@ -1377,22 +1417,18 @@ DRAMCtrl::processNextReqEvent()
             busState = READ_TO_WRITE;
         }
     } else {
-        // bool to check if write to free rank is found
-        bool found_write = false;
-
         // If we are changing command type, incorporate the minimum
         // bus turnaround delay
-        found_write = chooseNext(writeQueue,
-                                 switched_cmd_type ? std::min(tRTW, tCS) : 0);
+        DRAMPacket* dram_pkt = chooseNext(writeQueue, switched_cmd_type ?
+                                          std::min(tRTW, tCS) : 0);
 
         // if no writes to an available rank are found then return.
         // There could be reads to the available ranks. However, to avoid
         // adding more complexity to the code, return at this point and wait
         // for a refresh event to kick things into action again.
-        if (!found_write)
+        if (dram_pkt == NULL)
             return;
 
-        DRAMPacket* dram_pkt = writeQueue.front();
         assert(dram_pkt->rankRef.isAvailable());
         // sanity check
         assert(dram_pkt->size <= burstSize);
@@ -1407,7 +1443,7 @@ DRAMCtrl::processNextReqEvent()
 
         doDRAMAccess(dram_pkt);
 
-        writeQueue.pop_front();
+        writeQueue.remove(dram_pkt);
         isInWriteQueue.erase(burstAlign(dram_pkt->addr));
         delete dram_pkt;
 
@@ -1444,7 +1480,7 @@ DRAMCtrl::processNextReqEvent()
 }
 
 pair<uint64_t, bool>
-DRAMCtrl::minBankPrep(const deque<DRAMPacket*>& queue,
+DRAMCtrl::minBankPrep(const DRAMQueue& queue,
                       Tick min_col_at) const
 {
     uint64_t bank_mask = 0;
@@ -1461,14 +1497,6 @@ DRAMCtrl::minBankPrep(const deque<DRAMPacket*>& queue,
     // delay on the data bus
     bool hidden_bank_prep = false;
 
-    // determine if we have queued transactions targetting the
-    // bank in question
-    vector<bool> got_waiting(ranksPerChannel * banksPerRank, false);
-    for (const auto& p : queue) {
-        if(p->rankRef.isAvailable())
-            got_waiting[p->bankId] = true;
-    }
-
     // Find command with optimal bank timing
     // Will prioritize commands that can issue seamlessly.
     for (int i = 0; i < ranksPerChannel; i++) {
@@ -1476,10 +1504,9 @@ DRAMCtrl::minBankPrep(const deque<DRAMPacket*>& queue,
             uint16_t bank_id = i * banksPerRank + j;
 
             // if we have waiting requests for the bank, and it is
-            // amongst the first available, update the mask
-            if (got_waiting[bank_id]) {
-                // make sure this rank is not currently refreshing.
-                assert(ranks[i]->isAvailable());
+            // amongst the first available, update the mask. skip the
+            // rank if it is currently refreshing.
+            if (queue.bank(bank_id).count != 0 && ranks[i]->isAvailable()) {
                 // simplistic approximation of when the bank can issue
                 // an activate, ignoring any rank-to-rank switching
                 // cost in this calculation
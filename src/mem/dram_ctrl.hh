@@ -52,8 +52,9 @@
 #define __MEM_DRAM_CTRL_HH__
 
 #include <deque>
+#include <map>
 #include <string>
-#include <unordered_set>
+#include <unordered_map>
 
 #include "base/statistics.hh"
 #include "enums/AddrMap.hh"
@@ -460,15 +461,90 @@ class DRAMCtrl : public AbstractMemory
         Bank& bankRef;
         Rank& rankRef;
 
+        /**
+         * Position in the arrival order of the queue the packet is in,
+         * set when the packet is enqueued
+         */
+        uint64_t seqNum;
+
         DRAMPacket(PacketPtr _pkt, bool is_read, uint8_t _rank, uint8_t _bank,
                    uint32_t _row, uint16_t bank_id, Addr _addr,
                    unsigned int _size, Bank& bank_ref, Rank& rank_ref)
             : entryTime(curTick()), readyTime(curTick()),
               pkt(_pkt), isRead(is_read), rank(_rank), bank(_bank), row(_row),
               bankId(bank_id), addr(_addr), size(_size), burstHelper(NULL),
-              bankRef(bank_ref), rankRef(rank_ref)
+              bankRef(bank_ref), rankRef(rank_ref), seqNum(0)
+        { }
+
+        /** Is this packet older than the given one in the same queue? */
+        bool olderThan(const DRAMPacket* other) const
+        { return other == NULL || seqNum < other->seqNum; }
+
+    };
+
+    /**
+     * A queue of DRAM packets that is organised by bank, and within
+     * each bank by row. This allows the scheduler to find the oldest
+     * row hit or the oldest request to a bank without walking through
+     * the whole queue, so that the cost of a scheduling decision does
+     * not grow with the queue depth. The arrival order is kept as a
+     * sequence number per packet, which lets the scheduler pick
+     * exactly the packet that a scan of a single FIFO would pick.
+     */
+    class DRAMQueue {
+
+      public:
+
+        /** The requests to one row of a bank in arrival order */
+        typedef std::deque<DRAMPacket*> RowQueue;
+
+        /** The requests to one bank, by row */
+        class BankQueue {
+
+          public:
+
+            std::map<uint32_t, RowQueue> rows;
+
+            /** Number of requests to this bank */
+            size_t count;
+
+            BankQueue() : count(0)
+            { }
+
+            /** @return the number of requests to the given row */
+            size_t countTo(uint32_t row) const;
+
+            /** @return the oldest request to the given row, or NULL */
+            DRAMPacket* oldestTo(uint32_t row) const;
+
+            /** @return the oldest request to another row, or NULL */
+            DRAMPacket* oldestNotTo(uint32_t row) const;
+        };
+
+        DRAMQueue() : count(0), nextSeqNum(0)
         { }
 
+        /** Set the total number of banks in all ranks */
+        void init(unsigned int num_banks) { banks.resize(num_banks); }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        unsigned int numBanks() const { return banks.size(); }
+        const BankQueue& bank(uint16_t bank_id) const
+        { return banks[bank_id]; }
+
+        /** Append a request, making it the youngest in the queue */
+        void push_back(DRAMPacket* dram_pkt);
+
+        /** Remove the given request from the queue */
+        void remove(DRAMPacket* dram_pkt);
+
+      private:
+
+        std::vector<BankQueue> banks;
+        size_t count;
+        uint64_t nextSeqNum;
     };
 
     /**
@@ -568,28 +644,27 @@ class DRAMCtrl : public AbstractMemory
 
     /**
      * The memory schduler/arbiter - picks which request needs to
-     * go next, based on the specified policy such as FCFS or FR-FCFS
-     * and moves it to the head of the queue.
+     * go next, based on the specified policy such as FCFS or FR-FCFS.
      * Prioritizes accesses to the same rank as previous burst unless
      * controller is switching command type.
      *
      * @param queue Queued requests to consider
      * @param extra_col_delay Any extra delay due to a read/write switch
-     * @return true if a packet is scheduled to a rank which is available else
-     * false
+     * @return the chosen packet, which goes to a rank that is available,
+     * or NULL if there is no such packet
      */
-    bool chooseNext(std::deque<DRAMPacket*>& queue, Tick extra_col_delay);
+    DRAMPacket* chooseNext(const DRAMQueue& queue, Tick extra_col_delay);
 
     /**
-     * For FR-FCFS policy reorder the read/write queue depending on row buffer
-     * hits and earliest bursts available in DRAM
+     * For FR-FCFS policy pick a packet from the read/write queue depending
+     * on row buffer hits and earliest bursts available in DRAM
      *
      * @param queue Queued requests to consider
      * @param extra_col_delay Any extra delay due to a read/write switch
-     * @return true if a packet is scheduled to a rank which is available else
-     * false
+     * @return the chosen packet, which goes to a rank that is available,
+     * or NULL if there is no such packet
      */
-    bool reorderQueue(std::deque<DRAMPacket*>& queue, Tick extra_col_delay);
+    DRAMPacket* reorderQueue(const DRAMQueue& queue, Tick extra_col_delay);
 
     /**
      * Find which are the earliest banks ready to issue an activate
@@ -601,7 +676,7 @@ class DRAMCtrl : public AbstractMemory
      * @return One-hot encoded mask of bank indices
      * @return boolean indicating burst can issue seamlessly, with no gaps
      */
-    std::pair<uint64_t, bool> minBankPrep(const std::deque<DRAMPacket*>& queue,
+    std::pair<uint64_t, bool> minBankPrep(const DRAMQueue& queue,
                                           Tick min_col_at) const;
 
     /**
@@ -648,17 +723,17 @@ class DRAMCtrl : public AbstractMemory
     /**
      * The controller's main read and write queues
      */
-    std::deque<DRAMPacket*> readQueue;
-    std::deque<DRAMPacket*> writeQueue;
+    DRAMQueue readQueue;
+    DRAMQueue writeQueue;
 
     /**
      * To avoid iterating over the write queue to check for
-     * overlapping transactions, maintain a set of burst addresses
-     * that are currently queued. Since we merge writes to the same
-     * location we never have more than one address to the same burst
-     * address.
+     * overlapping transactions, maintain a map of the burst addresses
+     * that are currently queued to their packets. Since we merge
+     * writes to the same location we never have more than one packet
+     * to the same burst address.
      */
-    std::unordered_set<Addr> isInWriteQueue;
+    std::unordered_map<Addr, DRAMPacket*> isInWriteQueue;
 
     /**
      * Response queue where read packets wait after we're done working
@@ -27,6 +27,7 @@
 # either expressed or implied, of the FreeBSD Project.
 
 from MemObject import MemObject
+from XBar import NoncoherentXBar
 from m5.params import *
 from m5.proxy import *
 
@@ -60,7 +61,12 @@ class Dtu(BaseDtu):
 
     num_cmd_epid_bits = Param.Unsigned(8, "Number of bits used to identify the endpoint in a command")
 
+    cmd_queue_size = Param.Unsigned(1, "Number of commands that can be in flight at once (at most 64)")
+
+    # max_noc_packet_size, block_size, the buffers and the latencies can also be changed after
+    # instantiation, e.g., in the children of m5.fork()
     max_noc_packet_size = Param.MemorySize("1kB", "Maximum size of a NoC packet (needs to be the same for all DTUs)")
+    max_dma_packets = Param.Unsigned(1, "Maximum number of NoC packets a READ/WRITE command has in flight")
 
     memory_ep = Param.Unsigned(7, "The memory endpoint")
     memory_pe = Param.Unsigned(0, "The memory PE to use")
@@ -70,7 +76,18 @@ class Dtu(BaseDtu):
     block_size = Param.MemorySize("64B", "The block size with which to access the local memory")
 
     buf_count = Param.Unsigned(4, "The number of temporary buffers for transfers")
-    buf_size = Param.MemorySize("1kB", "The size of a temporary buffer")
+    buf_size = Param.MemorySize("1kB", "The maximum size of a transfer through a buffer")
+
+    pool_packets = Param.Bool(True, "Recycle the packets, requests and payloads we generate")
+
+    trace = Param.Bool(False, "Record the events of this DTU in <name>.trace in the output directory")
+    trace_buffer_size = Param.Unsigned(4096, "Number of trace records to collect before writing them")
+
+    irq_vector = Param.Unsigned(0x40, "The vector of the interrupt that signals new messages (x86 only)")
+    irq_apic_id = Param.Unsigned(0, "The id of the local APIC that receives the interrupts")
+
+    max_msg_retries = Param.Unsigned(4, "Number of times a message is sent again if the receive buffer is full")
+    msg_retry_delay = Param.Cycles(64, "Cycles to wait before the first retry (doubled for each further retry)")
 
     register_access_latency = Param.Cycles(1, "Latency for CPU register accesses")
     
@@ -80,3 +97,32 @@ class Dtu(BaseDtu):
     transfer_to_mem_request_latency = Param.Cycles(1, "Number of cycles passed for requesting something from local memory, when transferring")
     transfer_to_noc_latency = Param.Cycles(3, "Number of cycles passed from collecting the data in the buffer until sending it to the NoC");
     noc_to_transfer_latency = Param.Cycles(3, "Number of cycles passed from receiving data from the NoC until starting to transfer it to the local memory");
+
+class NocTopology(Enum): vals = ['mesh', 'torus']
+
+class DtuNoc(NoncoherentXBar):
+    type = 'DtuNoc'
+    cxx_header = "mem/dtu/noc.hh"
+
+    topology = Param.NocTopology('mesh', "The arrangement of the routers")
+    cols = Param.Unsigned("Number of routers per row (core_id % cols is the x coordinate)")
+    rows = Param.Unsigned("Number of routers per column (core_id / cols is the y coordinate)")
+
+    link_width = Param.Unsigned(16, "Number of bytes a link transmits per cycle")
+    router_latency = Param.Cycles(1, "Number of cycles a router needs to forward a header")
+    link_latency = Param.Cycles(1, "Number of cycles a header needs to traverse a link")
+
+    # the PEs are addressed by the upper 8 bits of the NoC address
+    decode_shift = 56
+
+class NocLink(MemObject):
+    type = 'NocLink'
+    cxx_header = "mem/dtu/noc_link.hh"
+
+    pe_slave = SlavePort("Port that receives the requests of the PE")
+    pe_master = MasterPort("Port that sends requests from the NoC to the PE")
+    noc_master = MasterPort("Port that sends the requests of the PE to the NoC")
+    noc_slave = SlavePort("Port that receives requests from the NoC for the PE")
+
+    noc_eventq_index = Param.UInt32(0, "The event queue of the NoC side")
+    latency = Param.Latency('10ns', "Latency of the link (at least the simulation quantum)")
@@ -80,7 +80,8 @@ BaseDtu::DtuSlavePort::DtuSlavePort(const std::string& _name, BaseDtu& _dtu)
     dtu(_dtu),
     busy(false),
     sendReqRetry(false),
-    pendingResponses()
+    pendingResponses(),
+    unsentResponses(0)
 { }
 
 void
@@ -98,6 +99,8 @@ BaseDtu::DtuSlavePort::requestFinished()
         sendReqRetry = false;
         sendRetryReq();
     }
+
+    dtu.checkDrained();
 }
 
 void
@@ -111,6 +114,7 @@ BaseDtu::DtuSlavePort::schedTimingResp(PacketPtr pkt, Tick when)
 
     auto respEvent = new ResponseEvent(*this, pkt);
     dtu.schedule(respEvent, when);
+    unsentResponses++;
 }
 
 Tick
@@ -183,10 +187,13 @@ BaseDtu::DtuSlavePort::recvRespRetry()
             DPRINTF(DtuSlavePort, "Poping %p from queue\n", ev);
             pendingResponses.pop();
             delete ev;
+            unsentResponses--;
         }
         else
             break;
     }
+
+    dtu.checkDrained();
 }
 
 void
@@ -209,7 +216,11 @@ BaseDtu::DtuSlavePort::ResponseEvent::process()
         }
         // if it succeeded, let the event system delete the event
         else
+        {
             setFlags(AutoDelete);
+            port.unsentResponses--;
+            port.dtu.checkDrained();
+        }
     }
     else
     {
@@ -378,6 +389,18 @@ BaseDtu::schedNocRequestFinished(Tick when)
     schedule(nocRequestFinishedEvent, when);
 }
 
+bool
+BaseDtu::portsIdle() const
+{
+    // the master ports drain their packet queues on their own. the NoC slave port stays busy in
+    // atomic mode, so that we only wait for the timing requests that are still being handled
+    return !nocRequestFinishedEvent.scheduled() &&
+           nocSlavePort.isIdle() &&
+           icacheSlavePort.isIdle() &&
+           dcacheSlavePort.isIdle() &&
+           cacheMemSlavePort.isIdle();
+}
+
 void
 BaseDtu::nocRequestFinished()
 {
@@ -107,7 +107,7 @@ class BaseDtu : public MemObject
 
         bool sendReqRetry;
 
-        struct ResponseEvent : public Event
+        struct ResponseEvent : public PooledEvent<ResponseEvent>
         {
             DtuSlavePort& port;
 
@@ -127,10 +127,15 @@ class BaseDtu : public MemObject
 
         std::queue<ResponseEvent*> pendingResponses;
 
+        // the number of responses that have been scheduled, but not been accepted yet
+        unsigned unsentResponses;
+
       public:
 
         DtuSlavePort(const std::string& _name, BaseDtu& _dtu);
 
+        bool isIdle() const { return unsentResponses == 0; }
+
         virtual bool handleRequest(PacketPtr pkt, bool *busy, bool functional) = 0;
 
         void schedTimingResp(PacketPtr pkt, Tick when);
@@ -261,8 +266,15 @@ class BaseDtu : public MemObject
 
     virtual bool handleCacheMemRequest(PacketPtr pkt, bool functional) = 0;
 
+    /**
+     * Called whenever the DTU might have become idle. Signals that draining is complete, if so.
+     */
+    virtual void checkDrained() = 0;
+
   protected:
 
+    bool portsIdle() const;
+
     void nocRequestFinished();
 
     void checkWatchRange(PacketPtr pkt);
@@ -31,12 +31,15 @@
 #include <iomanip>
 #include <sstream>
 
+#include "base/intmath.hh"
+#include "debug/Drain.hh"
 #include "debug/Dtu.hh"
 #include "debug/DtuBuf.hh"
 #include "debug/DtuCmd.hh"
 #include "debug/DtuPackets.hh"
 #include "debug/DtuSysCalls.hh"
 #include "debug/DtuPower.hh"
+#include "config/the_isa.hh"
 #include "cpu/simple/base.hh"
 #include "mem/dtu/dtu.hh"
 #include "mem/dtu/msg_unit.hh"
@@ -44,8 +47,13 @@
 #include "mem/dtu/xfer_unit.hh"
 #include "mem/page_table.hh"
 #include "sim/system.hh"
+#include "sim/full_system.hh"
 #include "sim/process.hh"
 
+#if THE_ISA == X86_ISA
+#include "arch/x86/intmessage.hh"
+#endif
+
 static const char *cmdNames[] =
 {
     "IDLE",
@@ -55,6 +63,7 @@ static const char *cmdNames[] =
     "WRITE",
     "INC_READ_PTR",
     "WAKEUP_CORE",
+    "ATOMIC",
 };
 
 Dtu::Dtu(DtuParams* p)
@@ -62,17 +71,28 @@ Dtu::Dtu(DtuParams* p)
     masterId(p->system->getMasterId(name())),
     system(p->system),
     regFile(name() + ".regFile", p->num_endpoints),
-    msgUnit(new MessageUnit(*this)),
-    memUnit(new MemoryUnit(*this)),
+    msgUnit(new MessageUnit(*this, p->cmd_queue_size, p->max_msg_retries, p->msg_retry_delay)),
+    memUnit(new MemoryUnit(*this, p->cmd_queue_size, p->max_dma_packets)),
     xferUnit(new XferUnit(*this, p->block_size, p->buf_count, p->buf_size)),
+    reqPool(p->pool_packets),
+    pktPool(p->pool_packets),
+    payloadPool(p->pool_packets),
+    memStatePool(p->pool_packets),
+    nocStatePool(p->pool_packets),
     executeCommandEvent(*this),
-    finishCommandEvent(*this),
-    cmdInProgress(false),
+    cmdSlots(),
+    cmdRegLatched(false),
     memEp(p->memory_ep),
+    irqVector(p->irq_vector),
+    irqApicId(p->irq_apic_id),
+    pollStart(MaxTick),
+    wakeupStart(MaxTick),
+    trace(p->trace ? new DtuTrace(name() + ".trace", p->core_id, p->trace_buffer_size) : NULL),
     atomicMode(p->system->isAtomicMode()),
     numEndpoints(p->num_endpoints),
     maxNocPacketSize(p->max_noc_packet_size),
     numCmdEpidBits(p->num_cmd_epid_bits),
+    cmdQueueSize(p->cmd_queue_size),
     blockSize(p->block_size),
     bufCount(p->buf_count),
     bufSize(p->buf_size),
@@ -84,6 +104,10 @@ Dtu::Dtu(DtuParams* p)
     nocToTransferLatency(p->noc_to_transfer_latency)
 {
     assert(p->buf_size >= maxNocPacketSize);
+    assert(cmdQueueSize > 0 && cmdQueueSize <= maxCmdQueueSize);
+
+    for (unsigned i = 0; i < cmdQueueSize; ++i)
+        cmdSlots.push_back(new CommandSlot(*this, i));
 
     regFile.set(memEp, EpReg::TGT_COREID, p->memory_pe);
     regFile.set(memEp, EpReg::REQ_REM_ADDR, p->memory_offset);
@@ -93,9 +117,118 @@ Dtu::Dtu(DtuParams* p)
 
 Dtu::~Dtu()
 {
+    for (auto slot : cmdSlots)
+        delete slot;
+
     delete xferUnit;
     delete memUnit;
     delete msgUnit;
+    delete trace;
+}
+
+void
+Dtu::notifyFork()
+{
+    if (trace)
+        trace->restart();
+}
+
+void
+Dtu::paramsChanged()
+{
+    const Params *p = params();
+
+    fatal_if(p->num_endpoints != numEndpoints ||
+             p->num_cmd_epid_bits != numCmdEpidBits ||
+             p->cmd_queue_size != cmdQueueSize,
+             "%s: the endpoints and the command queue cannot be changed\n", name());
+    fatal_if(p->buf_size < p->max_noc_packet_size,
+             "%s: the buffers need to hold a NoC packet\n", name());
+    fatal_if(!isPowerOf2(p->block_size), "%s: the block size needs to be a power of 2\n", name());
+
+    maxNocPacketSize = p->max_noc_packet_size;
+    blockSize = p->block_size;
+    bufCount = p->buf_count;
+    bufSize = p->buf_size;
+    xferUnit->resize(blockSize, bufCount, bufSize);
+
+    registerAccessLatency = p->register_access_latency;
+    commandToNocRequestLatency = p->command_to_noc_request_latency;
+    startMsgTransferDelay = p->start_msg_transfer_delay;
+    transferToMemRequestLatency = p->transfer_to_mem_request_latency;
+    transferToNocLatency = p->transfer_to_noc_latency;
+    nocToTransferLatency = p->noc_to_transfer_latency;
+}
+
+bool
+Dtu::isIdle() const
+{
+    for (auto slot : cmdSlots)
+    {
+        if (slot->busy || slot->finishEvent.scheduled())
+            return false;
+    }
+
+    return !executeCommandEvent.scheduled() &&
+           xferUnit->isIdle() &&
+           msgUnit->isIdle() &&
+           memUnit->isIdle() &&
+           portsIdle();
+}
+
+DrainState
+Dtu::drain()
+{
+    if (!isIdle())
+    {
+        DPRINTF(Drain, "%s: waiting for the running commands and transfers\n", name());
+        return DrainState::Draining;
+    }
+    return DrainState::Drained;
+}
+
+void
+Dtu::checkDrained()
+{
+    if (drainState() == DrainState::Draining && isIdle())
+    {
+        DPRINTF(Drain, "%s: drained\n", name());
+        signalDrainDone();
+    }
+}
+
+void
+Dtu::regStats()
+{
+    BaseDtu::regStats();
+
+    for (unsigned i = 0; i < numCmdOpcodes; ++i)
+    {
+        cmdTime[i]
+            .init(16)
+            .name(name() + ".cmdTime" + cmdNames[i])
+            .desc(std::string("Cycles from starting to finishing ") + cmdNames[i] + " commands")
+            .flags(Stats::nozero);
+    }
+
+    irqs
+        .name(name() + ".irqs")
+        .desc("Number of interrupts sent to the local APIC for new messages");
+    idlePolls
+        .name(name() + ".idlePolls")
+        .desc("Number of reads of MSG_CNT by the core while no message was pending");
+    idlePollCycles
+        .name(name() + ".idlePollCycles")
+        .desc("Cycles from the first unsuccessful poll of MSG_CNT until the next message");
+    wakeupLatency
+        .init(16)
+        .name(name() + ".wakeupLatency")
+        .desc("Cycles from waking up the core for a message until its next register access")
+        .flags(Stats::nozero);
+
+    msgUnit->regStats();
+    memUnit->regStats();
+    xferUnit->regStats();
 }
 
 PacketPtr
@@ -103,11 +236,27 @@ Dtu::generateRequest(Addr paddr, Addr size, MemCmd cmd)
 {
     Request::Flags flags;
 
-    auto req = new Request(paddr, size, flags, masterId);
+    auto req = reqPool.create(paddr, size, flags, masterId);
+
+    auto pkt = pktPool.create(req, cmd);
+    pkt->payload = payloadPool.alloc(size);
+    pkt->dataStatic(pkt->payload->data);
+
+    return pkt;
+}
+
+PacketPtr
+Dtu::generateRequest(Addr paddr, Addr size, MemCmd cmd, uint8_t *data, Payload *payload)
+{
+    Request::Flags flags;
+
+    auto req = reqPool.create(paddr, size, flags, masterId);
 
-    auto pkt = new Packet(req, cmd);
-    auto pktData = new uint8_t[size];
-    pkt->dataDynamic(pktData);
+    auto pkt = pktPool.create(req, cmd);
+    pkt->payload = payload;
+    if (payload)
+        payloadPool.ref(payload);
+    pkt->dataStatic(data);
 
     return pkt;
 }
@@ -115,25 +264,34 @@ Dtu::generateRequest(Addr paddr, Addr size, MemCmd cmd)
 void
 Dtu::freeRequest(PacketPtr pkt)
 {
-    delete pkt->req;
-    delete pkt;
+    // the packet would delete the request otherwise
+    assert(!pkt->isRequest() || pkt->needsResponse());
+
+    Request *req = pkt->req;
+    auto dpkt = static_cast<DtuPacket*>(pkt);
+
+    if (dpkt->payload)
+        payloadPool.unref(dpkt->payload);
+    pktPool.destroy(dpkt);
+    reqPool.destroy(req);
 }
 
 Dtu::Command
-Dtu::getCommand()
+Dtu::getCommandReg()
 {
     assert(numCmdEpidBits + numCmdOpcodeBits <= sizeof(RegFile::reg_t) * 8);
 
     using reg_t = RegFile::reg_t;
 
     /*
-     *   COMMAND            0
-     * |--------------------|
-     * |  epid   |  opcode  |
-     * |--------------------|
+     *   COMMAND                      0
+     * |------------------------------|
+     * |   arg   |  epid   |  opcode  |
+     * |------------------------------|
      */
     reg_t opcodeMask = ((reg_t)1 << numCmdOpcodeBits) - 1;
     reg_t epidMask   = (((reg_t)1 << numCmdEpidBits) - 1) << numCmdOpcodeBits;
+    unsigned argShift = numCmdEpidBits + numCmdOpcodeBits;
 
     auto reg = regFile.get(CmdReg::COMMAND);
 
@@ -143,23 +301,85 @@ Dtu::getCommand()
 
     cmd.epId = (reg & epidMask) >> numCmdOpcodeBits;
 
+    cmd.arg = argShift < sizeof(reg_t) * 8 ? reg >> argShift : 0;
+
     return cmd;
 }
 
+int
+Dtu::allocateCmdSlot()
+{
+    for (unsigned i = 0; i < cmdQueueSize; ++i)
+    {
+        if (!cmdSlots[i]->busy)
+            return i;
+    }
+    return -1;
+}
+
+void
+Dtu::updateCmdBusy()
+{
+    RegFile::reg_t busy = 0;
+    for (unsigned i = 0; i < cmdQueueSize; ++i)
+    {
+        if (cmdSlots[i]->busy)
+            busy |= static_cast<RegFile::reg_t>(1) << i;
+    }
+
+    regFile.set(DtuReg::CMD_BUSY, busy);
+}
+
 void
 Dtu::executeCommand()
 {
-    Command cmd = getCommand();
-    if(cmd.opcode == CommandOpcode::IDLE)
+    Command cmdReg = getCommandReg();
+    if(cmdReg.opcode == CommandOpcode::IDLE)
         return;
 
-    assert(!cmdInProgress);
-    assert(cmd.epId < numEndpoints);
+    assert(cmdReg.epId < numEndpoints);
+
+    // SW is only allowed to write a command if the command register is idle, which is only the
+    // case if there is a free slot
+    int slot = allocateCmdSlot();
+    assert(slot != -1);
+    assert(!cmdRegLatched);
+
+    // latch the arguments, so that the command registers can be reused for the next command
+    Command &cmd = cmdSlots[slot]->cmd;
+    cmd.opcode     = cmdReg.opcode;
+    cmd.epId       = cmdReg.epId;
+    cmd.arg        = cmdReg.arg;
+    cmd.error      = Error::NONE;
+    cmd.startTick  = curTick();
+    cmd.dataAddr   = regFile.get(CmdReg::DATA_ADDR);
+    cmd.dataSize   = regFile.get(CmdReg::DATA_SIZE);
+    cmd.offset     = regFile.get(CmdReg::OFFSET);
+    cmd.replyEpId  = regFile.get(CmdReg::REPLY_EPID);
+    cmd.replyLabel = regFile.get(CmdReg::REPLY_LABEL);
+
+    cmdSlots[slot]->busy = true;
+    regFile.set(DtuReg::CMD_SLOT, slot);
+    updateCmdBusy();
+
+    // let the SW know that it can issue the next command. if the queue is full, the command
+    // register stays occupied until one of the commands is finished
+    if (allocateCmdSlot() != -1)
+        regFile.set(CmdReg::COMMAND, 0);
+    else
+        cmdRegLatched = true;
 
-    cmdInProgress = true;
+    DPRINTF(DtuCmd, "Starting command %s with EP%d in slot %d\n",
+            cmdNames[static_cast<size_t>(cmd.opcode)], cmd.epId, slot);
 
-    DPRINTF(DtuCmd, "Starting command %s with EP%d\n",
-            cmdNames[static_cast<size_t>(cmd.opcode)], cmd.epId);
+    if (trace)
+    {
+        auto &rec = trace->add(DtuTrace::Event::CMD_START);
+        rec.epId = cmd.epId;
+        rec.slot = slot;
+        rec.kind = static_cast<uint8_t>(cmd.opcode);
+        rec.size = cmd.dataSize;
+    }
 
     switch (cmd.opcode)
     {
@@ -173,13 +393,17 @@ Dtu::executeCommand()
     case CommandOpcode::WRITE:
         memUnit->startWrite(cmd);
         break;
+    case CommandOpcode::ATOMIC:
+        memUnit->startAtomic(cmd);
+        break;
     case CommandOpcode::INC_READ_PTR:
-        msgUnit->incrementReadPtr(cmd.epId);
-        finishCommand();
+        // the argument is the number of messages to acknowledge; 0 acknowledges one message
+        msgUnit->incrementReadPtr(cmd.epId, cmd.arg == 0 ? 1 : cmd.arg);
+        finishCommand(slot);
         break;
     case CommandOpcode::WAKEUP_CORE:
         wakeupCore();
-        finishCommand();
+        finishCommand(slot);
         break;
     default:
         // TODO error handling
@@ -188,19 +412,53 @@ Dtu::executeCommand()
 }
 
 void
-Dtu::finishCommand()
+Dtu::finishCommand(unsigned slot)
 {
-    Command cmd = getCommand();
+    Command &cmd = cmdSlots[slot]->cmd;
+
+    assert(cmdSlots[slot]->busy);
 
-    assert(cmdInProgress);
+    cmdTime[static_cast<size_t>(cmd.opcode)].sample(ticksToCycles(curTick() - cmd.startTick));
 
-    DPRINTF(DtuCmd, "Finished command %s with EP%d\n",
-            cmdNames[static_cast<size_t>(cmd.opcode)], cmd.epId);
+    if (trace)
+    {
+        auto &rec = trace->add(DtuTrace::Event::CMD_FINISH);
+        rec.epId = cmd.epId;
+        rec.slot = slot;
+        rec.kind = static_cast<uint8_t>(cmd.opcode);
+        rec.error = static_cast<uint8_t>(cmd.error);
+        rec.arg = cmd.startTick;
+    }
+
+    DPRINTF(DtuCmd, "Finished command %s with EP%d in slot %u (error %u)\n",
+            cmdNames[static_cast<size_t>(cmd.opcode)], cmd.epId, slot,
+            static_cast<unsigned>(cmd.error));
+
+    /*
+     *   CMD_ERROR      0
+     * |----------------|
+     * |  slot | error  |
+     * |----------------|
+     */
+    if (cmd.error != Error::NONE)
+    {
+        RegFile::reg_t err = static_cast<RegFile::reg_t>(slot) << 8;
+        err |= static_cast<RegFile::reg_t>(cmd.error);
+        regFile.set(DtuReg::CMD_ERROR, err);
+    }
 
     // let the SW know that the command is finished
-    regFile.set(CmdReg::COMMAND, 0);
+    cmdSlots[slot]->busy = false;
+    updateCmdBusy();
 
-    cmdInProgress = false;
+    // if the queue was full, the SW can issue the next command now
+    if (cmdRegLatched)
+    {
+        regFile.set(CmdReg::COMMAND, 0);
+        cmdRegLatched = false;
+    }
+
+    checkDrained();
 }
 
 void
@@ -216,6 +474,77 @@ Dtu::wakeupCore()
     }
 }
 
+void
+Dtu::messageReceived(unsigned epId)
+{
+    if (pollStart != MaxTick)
+    {
+        idlePollCycles += ticksToCycles(curTick() - pollStart);
+        pollStart = MaxTick;
+    }
+
+    RegFile::reg_t irqEps = regFile.get(DtuReg::IRQ_EN);
+    if (epId < sizeof(RegFile::reg_t) * 8 && (irqEps & (static_cast<RegFile::reg_t>(1) << epId)))
+    {
+        DPRINTF(DtuPower, "EP%u: raising interrupt %#x\n", epId, irqVector);
+        sendIrq();
+    }
+
+    if(system->threadContexts.size() > 0 &&
+       system->threadContexts[0]->status() == ThreadContext::Suspended &&
+       wakeupStart == MaxTick)
+    {
+        wakeupStart = curTick();
+    }
+
+    wakeupCore();
+}
+
+void
+Dtu::sendIrq()
+{
+#if THE_ISA == X86_ISA
+    // without full system, there is no interrupt handler. waking up the core is all we can do.
+    if (!FullSystem)
+        return;
+
+    // send a fixed interrupt to the local APIC, as an IntDevice would do
+    X86ISA::TriggerIntMessage msg = 0;
+    msg.destination = irqApicId;
+    msg.vector = irqVector;
+    msg.deliveryMode = X86ISA::DeliveryMode::Fixed;
+
+    auto pkt = generateRequest(X86ISA::x86InterruptAddress(irqApicId, X86ISA::TriggerIntOffset),
+                               sizeof(X86ISA::TriggerIntMessage),
+                               MemCmd::MessageReq);
+    pkt->set<X86ISA::TriggerIntMessage>(msg);
+
+    sendMemRequest(pkt, 0, MemReqType::IRQ, Cycles(1));
+    irqs++;
+#endif
+}
+
+void
+Dtu::recordPoll(PacketPtr pkt)
+{
+    // the first register access after a wakeup concludes it
+    if (wakeupStart != MaxTick)
+    {
+        wakeupLatency.sample(ticksToCycles(curTick() - wakeupStart));
+        wakeupStart = MaxTick;
+    }
+
+    Addr msgCntAddr = static_cast<Addr>(DtuReg::MSG_CNT) * sizeof(RegFile::reg_t);
+    if (pkt->isRead() &&
+        pkt->getAddr() <= msgCntAddr && pkt->getAddr() + pkt->getSize() > msgCntAddr &&
+        regFile.get(DtuReg::MSG_CNT) == 0)
+    {
+        idlePolls++;
+        if (pollStart == MaxTick)
+            pollStart = curTick();
+    }
+}
+
 void
 Dtu::updateSuspendablePin()
 {
@@ -231,12 +560,12 @@ Dtu::updateSuspendablePin()
 
 void
 Dtu::sendMemRequest(PacketPtr pkt,
-                    unsigned epId,
+                    unsigned id,
                     MemReqType type,
                     Cycles delay)
 {
-    auto senderState = new MemSenderState();
-    senderState->epId = epId;
+    auto senderState = memStatePool.create();
+    senderState->id = id;
     senderState->mid = pkt->req->masterId();
     senderState->type = type;
 
@@ -257,13 +586,33 @@ Dtu::sendMemRequest(PacketPtr pkt,
 }
 
 void
-Dtu::sendNocRequest(NocPacketType type, PacketPtr pkt, Cycles delay, bool functional)
+Dtu::sendNocRequest(NocPacketType type,
+                    PacketPtr pkt,
+                    Cycles delay,
+                    bool functional,
+                    unsigned cmdSlot)
 {
-    auto senderState = new NocSenderState();
+    auto senderState = nocStatePool.create();
     senderState->packetType = type;
+    senderState->cmdSlot = cmdSlot;
+    senderState->srcCoreId = coreId;
+    if (type == NocPacketType::MESSAGE)
+        senderState->startTick = getCommand(cmdSlot).startTick;
+    else
+        senderState->startTick = curTick();
 
     pkt->pushSenderState(senderState);
 
+    if (trace)
+    {
+        auto &rec = trace->add(DtuTrace::Event::NOC_SEND);
+        rec.slot = cmdSlot;
+        rec.peer = NocAddr(pkt->getAddr()).coreId;
+        rec.kind = static_cast<uint8_t>(type);
+        rec.size = pkt->getSize();
+        rec.arg = senderState->startTick;
+    }
+
     if (functional)
     {
         sendFunctionalNocRequest(pkt);
@@ -280,6 +629,12 @@ Dtu::sendNocRequest(NocPacketType type, PacketPtr pkt, Cycles delay, bool functi
     }
 }
 
+void
+Dtu::sendNocMessage(PacketPtr pkt, Cycles delay, unsigned cmdSlot)
+{
+    msgUnit->sendMessage(pkt, delay, cmdSlot);
+}
+
 void
 Dtu::startTransfer(TransferType type,
                    NocAddr targetAddr,
@@ -288,7 +643,7 @@ Dtu::startTransfer(TransferType type,
                    PacketPtr pkt,
                    MessageHeader* header,
                    Cycles delay,
-                   bool last)
+                   unsigned cmdSlot)
 {
     xferUnit->startTransfer(type,
                             targetAddr,
@@ -297,7 +652,13 @@ Dtu::startTransfer(TransferType type,
                             pkt,
                             header,
                             delay,
-                            last);
+                            cmdSlot);
+}
+
+void
+Dtu::completeLocalWrite(unsigned cmdSlot, Addr size)
+{
+    memUnit->localWriteComplete(getCommand(cmdSlot), size);
 }
 
 void
@@ -305,6 +666,17 @@ Dtu::completeNocRequest(PacketPtr pkt)
 {
     auto senderState = dynamic_cast<NocSenderState*>(pkt->popSenderState());
 
+    if (trace)
+    {
+        auto &rec = trace->add(DtuTrace::Event::NOC_RESP);
+        rec.slot = senderState->cmdSlot;
+        rec.peer = NocAddr(pkt->getAddr()).coreId;
+        rec.kind = static_cast<uint8_t>(senderState->packetType);
+        rec.size = pkt->getSize();
+        rec.error = pkt->isError();
+        rec.arg = senderState->startTick;
+    }
+
     if(senderState->packetType == NocPacketType::CACHE_MEM_REQ)
     {
         Addr targetAddr = regs().get(numEndpoints - 1, EpReg::REQ_REM_ADDR);
@@ -313,17 +685,33 @@ Dtu::completeNocRequest(PacketPtr pkt)
         pkt->req->setPaddr(reqAddr);
         sendCacheMemResponse(pkt);
     }
+    else if(senderState->packetType == NocPacketType::MESSAGE)
+    {
+        msgUnit->finishTransmission(getCommand(senderState->cmdSlot), pkt);
+    }
+    else if(senderState->packetType == NocPacketType::ATOMIC_REQ)
+    {
+        memUnit->atomicComplete(getCommand(senderState->cmdSlot), pkt);
+    }
+    else if(senderState->packetType == NocPacketType::CREDITS)
+    {
+        // the command has already been finished; the receiver never rejects credits
+        assert(!pkt->isError());
+        freeRequest(pkt);
+    }
     else if(senderState->packetType != NocPacketType::CACHE_MEM_REQ_FUNC)
     {
+        Command &cmd = getCommand(senderState->cmdSlot);
+
         if (pkt->isWrite())
-            memUnit->writeComplete(pkt);
+            memUnit->writeComplete(cmd, pkt);
         else if (pkt->isRead())
-            memUnit->readComplete(pkt);
+            memUnit->readComplete(cmd, pkt);
         else
             panic("unexpected packet type\n");
     }
 
-    delete senderState;
+    nocStatePool.destroy(senderState);
 }
 
 void
@@ -340,7 +728,7 @@ Dtu::completeMemRequest(PacketPtr pkt)
     switch(senderState->type)
     {
     case MemReqType::TRANSFER:
-        xferUnit->recvMemResponse(senderState->epId,
+        xferUnit->recvMemResponse(senderState->id,
                                   pkt->getConstPtr<uint8_t>(),
                                   pkt->getSize(),
                                   pkt->headerDelay,
@@ -348,11 +736,19 @@ Dtu::completeMemRequest(PacketPtr pkt)
         break;
 
     case MemReqType::HEADER:
-        msgUnit->recvFromMem(getCommand(), pkt);
+        msgUnit->recvFromMem(getCommand(senderState->id), pkt);
+        break;
+
+    case MemReqType::IRQ:
+        // the local APIC has accepted the interrupt; nothing left to do
+        break;
+
+    case MemReqType::DESCRIPTORS:
+        memUnit->recvDescriptors(getCommand(senderState->id), pkt);
         break;
     }
 
-    delete senderState;
+    memStatePool.destroy(senderState);
     freeRequest(pkt);
 }
 
@@ -363,6 +759,16 @@ Dtu::handleNocRequest(PacketPtr pkt)
 
     auto senderState = dynamic_cast<NocSenderState*>(pkt->senderState);
 
+    if (trace)
+    {
+        auto &rec = trace->add(DtuTrace::Event::NOC_RECV);
+        rec.epId = NocAddr(pkt->getAddr()).epId;
+        rec.peer = senderState->srcCoreId;
+        rec.kind = static_cast<uint8_t>(senderState->packetType);
+        rec.size = pkt->getSize();
+        rec.arg = senderState->startTick;
+    }
+
     switch (senderState->packetType)
     {
     case NocPacketType::MESSAGE:
@@ -376,6 +782,12 @@ Dtu::handleNocRequest(PacketPtr pkt)
     case NocPacketType::CACHE_MEM_REQ_FUNC:
         memUnit->recvFunctionalFromNoc(pkt);
         break;
+    case NocPacketType::ATOMIC_REQ:
+        memUnit->recvAtomicFromNoc(pkt);
+        break;
+    case NocPacketType::CREDITS:
+        msgUnit->recvCreditsFromNoc(pkt);
+        break;
     default:
         panic("Unexpected NocPacketType\n");
     }
@@ -441,6 +853,9 @@ Dtu::forwardRequestToRegFile(PacketPtr pkt, bool isCpuRequest)
     // Strip the base address to handle requests based on the register address only.
     pkt->setAddr(oldAddr - regFileBaseAddr);
 
+    if (isCpuRequest)
+        recordPoll(pkt);
+
     bool commandWritten = regFile.handleRequest(pkt, isCpuRequest);
 
     // restore old address
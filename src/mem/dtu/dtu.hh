@@ -31,9 +31,12 @@
 #ifndef __MEM_DTU_DTU_HH__
 #define __MEM_DTU_DTU_HH__
 
+#include "base/statistics.hh"
 #include "mem/dtu/base.hh"
+#include "mem/dtu/event_trace.hh"
 #include "mem/dtu/regfile.hh"
 #include "mem/dtu/noc_addr.hh"
+#include "mem/dtu/pool.hh"
 #include "params/Dtu.hh"
 
 class MessageUnit;
@@ -50,11 +53,33 @@ class Dtu : public BaseDtu
         WRITE = (1 << 1),
     };
 
+    /**
+     * Flags in TGT_COREID of a send endpoint to address a group of cores instead of a single one.
+     * A SEND to a group reads the message from local memory once and sends a copy to each core.
+     * Both encodings can only address cores that fit into the core id of a NocAddr, i.e., cores
+     * 0..maxCoreId.
+     */
+    enum TargetFlags : uint64_t
+    {
+        // the cores <first> (bits 0..15) to <last> (bits 16..31), inclusive. the command fails
+        // with INV_TARGET if <first> is larger than <last> or <last> is larger than maxCoreId.
+        MULTICAST_RANGE = static_cast<uint64_t>(1) << 63,
+        // the cores whose bit is set in bits 0..61. thus, only cores 0..61 can be reached this
+        // way; the other cores need the range form.
+        MULTICAST_BITMAP = static_cast<uint64_t>(1) << 62,
+    };
+
+    static constexpr unsigned maxCoreId = (1 << 8) - 1;
+
+    static constexpr unsigned numBitmapCores = 62;
+
     enum MessageFlags : uint8_t
     {
         REPLY_FLAG = (1 << 0),
         GRANT_CREDITS_FLAG = (1 << 1),
         REPLY_ENABLED = (1 << 2),
+        // the message has no payload and is not stored; it only grants the credits of a reply
+        CREDITS_ONLY = (1 << 3),
     };
 
     struct MessageHeader
@@ -71,6 +96,55 @@ class Dtu : public BaseDtu
         uint64_t replyLabel;
     } M5_ATTR_PACKED;
 
+    // the argument of READ/WRITE commands
+    enum MemCmdFlags : uint64_t
+    {
+        // DATA_ADDR points to a list of DATA_SIZE MemDescriptors
+        MEM_VECTORED = 1 << 0,
+    };
+
+    // the maximum number of descriptors of a vectored READ/WRITE (more are denied with NO_PERM)
+    static constexpr unsigned maxMemDescriptors = 1024;
+
+    /**
+     * An entry in the descriptor list of a vectored READ/WRITE. <offset> is relative to the
+     * OFFSET register of the command.
+     */
+    struct MemDescriptor
+    {
+        uint64_t addr;
+        uint64_t offset;
+        uint64_t size;
+    } M5_ATTR_PACKED;
+
+    enum class AtomicOp : uint8_t
+    {
+        FETCH_ADD = 0,
+        CAS = 1,
+        SWAP = 2,
+    };
+
+    // the argument of ATOMIC commands: | 64-bit flag | op (2 bits) |
+    enum AtomicFlags : uint64_t
+    {
+        ATOMIC_OP_MASK = 0x3,
+        ATOMIC_64BIT = 1 << 2,
+    };
+
+    /**
+     * The payload of an ATOMIC request. The response carries the old value of the word in
+     * <operand>.
+     */
+    struct AtomicRequest
+    {
+        uint8_t op;
+        uint8_t size;
+        // the value to add, the new value for CAS or the value to swap in
+        uint64_t operand;
+        // the value CAS expects
+        uint64_t expected;
+    } M5_ATTR_PACKED;
+
     enum class NocPacketType
     {
         MESSAGE,
@@ -78,6 +152,8 @@ class Dtu : public BaseDtu
         WRITE_REQ,
         CACHE_MEM_REQ_FUNC,
         CACHE_MEM_REQ,
+        ATOMIC_REQ,
+        CREDITS,
     };
 
     enum class TransferType
@@ -91,12 +167,15 @@ class Dtu : public BaseDtu
     enum class MemReqType
     {
         TRANSFER,
-        HEADER
+        HEADER,
+        IRQ,
+        DESCRIPTORS
     };
 
     struct MemSenderState : public Packet::SenderState
     {
-        unsigned epId;
+        // the buffer id for transfers and the command slot for headers
+        unsigned id;
         MasterID mid;
         MemReqType type;
     };
@@ -104,6 +183,33 @@ class Dtu : public BaseDtu
     struct NocSenderState : public Packet::SenderState
     {
         NocPacketType packetType;
+        unsigned cmdSlot;
+        // used by the NoC to determine the position of the sender
+        unsigned srcCoreId;
+        // when the command that sent this packet has been started (for statistics)
+        Tick startTick;
+    };
+
+    /**
+     * The packets we generate. They remember the payload they point to (if they own a reference),
+     * so that the data can be shared between packets instead of being copied.
+     */
+    struct DtuPacket : public Packet
+    {
+        DtuPacket(const RequestPtr _req, MemCmd _cmd)
+            : Packet(_req, _cmd), payload()
+        {}
+
+        Payload *payload;
+    };
+
+    enum class Error
+    {
+        NONE = 0,
+        MISS_CREDITS = 1,   // not enough credits to send the message
+        RECV_BUF_FULL = 2,  // the receive buffer was still full after all retries
+        NO_PERM = 3,        // the memory endpoint does not allow the access
+        INV_TARGET = 4,     // the multicast targets in TGT_COREID are invalid
     };
 
     enum class CommandOpcode
@@ -115,50 +221,163 @@ class Dtu : public BaseDtu
         WRITE = 4,
         INC_READ_PTR = 5,
         WAKEUP_CORE = 6,
+        ATOMIC = 7,
     };
 
     struct Command
     {
         CommandOpcode opcode;
         unsigned epId;
+        // the command-specific argument in the upper bits of the command register
+        RegFile::reg_t arg;
+        // the result of the command; set before it is finished
+        Error error;
+        // when the command has been started
+        Tick startTick;
+        // the arguments are latched as soon as the command is accepted,
+        // because SW can already prepare the next command afterwards
+        Addr dataAddr;
+        Addr dataSize;
+        Addr offset;
+        unsigned replyEpId;
+        uint64_t replyLabel;
+        // the slot in the command queue
+        unsigned slot;
+    };
+
+  private:
+
+    struct FinishCommandEvent : public Event
+    {
+        Dtu& dtu;
+
+        unsigned slot;
+
+        FinishCommandEvent(Dtu& _dtu, unsigned _slot)
+            : dtu(_dtu), slot(_slot)
+        {}
+
+        void process() override
+        {
+            dtu.finishCommand(slot);
+        }
+
+        const char* description() const override { return "FinishCommandEvent"; }
+
+        const std::string name() const override { return dtu.name(); }
+    };
+
+    struct CommandSlot
+    {
+        CommandSlot(Dtu& dtu, unsigned slot)
+            : cmd(),
+              busy(false),
+              finishEvent(dtu, slot)
+        {
+            cmd.slot = slot;
+        }
+
+        Command cmd;
+        bool busy;
+        FinishCommandEvent finishEvent;
     };
 
   public:
 
     static constexpr unsigned numCmdOpcodeBits = 3;
 
+    static constexpr unsigned numCmdOpcodes = static_cast<unsigned>(CommandOpcode::ATOMIC) + 1;
+
+    static constexpr unsigned maxCmdQueueSize = sizeof(RegFile::reg_t) * 8;
+
   public:
 
+    typedef DtuParams Params;
+
     Dtu(DtuParams* p);
 
     ~Dtu();
 
+    const Params *params() const { return reinterpret_cast<const Params*>(_params); }
+
+    void notifyFork() override;
+
+    /**
+     * Supports changing the sizes, the buffers and the latencies, but not the structure of the DTU
+     * (endpoints, command queue).
+     */
+    void paramsChanged() override;
+
+    /**
+     * The DTU is drained as soon as no command is executing, all transfer buffers are free and
+     * all responses have been sent. This ensures that paramsChanged() does not interfere with a
+     * running transfer.
+     */
+    DrainState drain() override;
+
+    void checkDrained() override;
+
     RegFile &regs() { return regFile; }
     
     PacketPtr generateRequest(Addr addr, Addr size, MemCmd cmd);
+    /**
+     * Generates a request that uses <data> instead of allocating its own payload. If <payload> is
+     * given, the packet holds a reference to it. Otherwise, the caller has to keep <data> alive
+     * until the packet is freed.
+     */
+    PacketPtr generateRequest(Addr addr, Addr size, MemCmd cmd, uint8_t *data, Payload *payload);
     void freeRequest(PacketPtr pkt);
 
+    Payload *allocPayload(size_t size) { return payloadPool.alloc(size); }
+    void releasePayload(Payload *payload) { payloadPool.unref(payload); }
+
     void wakeupCore();
+
+    /**
+     * A message has been stored in the receive buffer of <epId>. Raises an interrupt, if enabled
+     * for <epId>, and wakes up the core.
+     */
+    void messageReceived(unsigned epId);
     
     void updateSuspendablePin();
 
     void forwardRequestToRegFile(PacketPtr pkt, bool isCpuRequest);
 
+  private:
+
+    void sendIrq();
+
+    void recordPoll(PacketPtr pkt);
+
+  public:
+
     void sendFunctionalMemRequest(PacketPtr pkt) { dcacheMasterPort.sendFunctional(pkt); }
 
-    void scheduleFinishOp(Cycles delay) { schedule(finishCommandEvent, clockEdge(delay)); }
+    Command &getCommand(unsigned slot) { return cmdSlots[slot]->cmd; }
+
+    void scheduleFinishOp(unsigned cmdSlot, Cycles delay, Error error = Error::NONE)
+    {
+        cmdSlots[cmdSlot]->cmd.error = error;
+        schedule(cmdSlots[cmdSlot]->finishEvent, clockEdge(delay));
+    }
 
     void scheduleCommand(Cycles delay) { schedule(executeCommandEvent, clockEdge(delay)); }
 
     void sendMemRequest(PacketPtr pkt,
-                        unsigned epId,
+                        unsigned id,
                         MemReqType type,
                         Cycles delay);
 
     void sendNocRequest(NocPacketType type,
                         PacketPtr pkt,
                         Cycles delay,
-                        bool functional = false);
+                        bool functional = false,
+                        unsigned cmdSlot = 0);
+
+    /**
+     * Sends a message that has been read from local memory (to all targets of a multicast)
+     */
+    void sendNocMessage(PacketPtr pkt, Cycles delay, unsigned cmdSlot);
 
     void startTransfer(TransferType type,
                        NocAddr targetAddr,
@@ -167,17 +386,27 @@ class Dtu : public BaseDtu
                        PacketPtr pkt = NULL,
                        MessageHeader* header = NULL,
                        Cycles delay = Cycles(0),
-                       bool last = false);
+                       unsigned cmdSlot = 0);
+
+    void completeLocalWrite(unsigned cmdSlot, Addr size);
 
     void printPacket(PacketPtr pkt) const;
 
+    void regStats() override;
+
   private:
 
-    Command getCommand();
+    bool isIdle() const;
+
+    Command getCommandReg();
+
+    int allocateCmdSlot();
+
+    void updateCmdBusy();
 
     void executeCommand();
 
-    void finishCommand();
+    void finishCommand(unsigned slot);
 
     void completeNocRequest(PacketPtr pkt) override;
 
@@ -203,37 +432,70 @@ class Dtu : public BaseDtu
 
     XferUnit *xferUnit;
 
+    // the packets we generate are recycled, because we create a lot of them
+    ObjectPool<Request> reqPool;
+    ObjectPool<DtuPacket> pktPool;
+    PayloadPool payloadPool;
+    ObjectPool<MemSenderState> memStatePool;
+    ObjectPool<NocSenderState> nocStatePool;
+
     EventWrapper<Dtu, &Dtu::executeCommand> executeCommandEvent;
-    
-    EventWrapper<Dtu, &Dtu::finishCommand> finishCommandEvent;
 
-    bool cmdInProgress;
+    std::vector<CommandSlot*> cmdSlots;
+
+    // true if the command register still holds a command that has already been accepted, because
+    // the queue was full afterwards. it is cleared as soon as a slot becomes free again.
+    bool cmdRegLatched;
 
     const unsigned memEp;
 
+    // the execution time of the commands, per opcode
+    Stats::Histogram cmdTime[numCmdOpcodes];
+
+    // the interrupt we send to the local APIC of the core on new messages
+    const unsigned irqVector;
+    const unsigned irqApicId;
+
+    // the tick of the first unsuccessful poll of MSG_CNT since the last message (MaxTick if none)
+    Tick pollStart;
+    // the tick at which we woke up the core for a message (MaxTick if it's awake)
+    Tick wakeupStart;
+
+    Stats::Scalar irqs;
+    Stats::Scalar idlePolls;
+    Stats::Scalar idlePollCycles;
+    Stats::Histogram wakeupLatency;
+
   public:
 
+    // NULL if tracing is disabled
+    DtuTrace *trace;
+
     const bool atomicMode;
 
     const unsigned numEndpoints;
 
-    const Addr maxNocPacketSize;
+    // the following can be changed on the fly (see paramsChanged)
+
+    Addr maxNocPacketSize;
 
     const unsigned numCmdEpidBits;
 
-    const size_t blockSize;
+    const unsigned cmdQueueSize;
+
+    size_t blockSize;
 
-    const size_t bufCount;
-    const size_t bufSize;
+    size_t bufCount;
+    size_t bufSize;
 
-    const Cycles registerAccessLatency;
+    Cycles registerAccessLatency;
 
-    const Cycles commandToNocRequestLatency;
-    const Cycles startMsgTransferDelay;
+    Cycles commandToNocRequestLatency;
+    Cycles startMsgTransferDelay;
 
-    const Cycles transferToMemRequestLatency;
-    const Cycles transferToNocLatency;
-    const Cycles nocToTransferLatency;
+    Cycles transferToMemRequestLatency;
+    Cycles transferToNocLatency;
+    Cycles nocToTransferLatency;
 };
 
 #endif // __MEM_DTU_DTU_HH__
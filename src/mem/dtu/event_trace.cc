@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include "base/callback.hh"
+#include "base/misc.hh"
+#include "base/output.hh"
+#include "mem/dtu/event_trace.hh"
+
+DtuTrace::DtuTrace(const std::string &fileName, unsigned _coreId, size_t bufferSize)
+    : stream(simout.create(fileName, true)),
+      coreId(_coreId),
+      records()
+{
+    fatal_if(!stream, "Unable to create DTU trace file %s\n", fileName);
+
+    records.reserve(bufferSize);
+
+    writeHeader();
+
+    // the destructor is not called at exit, so make sure that we write out the rest
+    registerExitCallback(new MakeCallback<DtuTrace, &DtuTrace::flush>(this));
+}
+
+DtuTrace::~DtuTrace()
+{
+    flush();
+}
+
+void
+DtuTrace::flush()
+{
+    if (records.empty())
+        return;
+
+    stream->write(reinterpret_cast<const char*>(records.data()),
+                  records.size() * sizeof(Record));
+    stream->flush();
+    records.clear();
+}
+
+void
+DtuTrace::restart()
+{
+    records.clear();
+    writeHeader();
+}
+
+void
+DtuTrace::writeHeader()
+{
+    stream->write("DTUTRACE", 8);
+    uint32_t version = VERSION;
+    uint32_t recordSize = sizeof(Record);
+    stream->write(reinterpret_cast<const char*>(&version), sizeof(version));
+    stream->write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __MEM_DTU_EVENT_TRACE_HH__
+#define __MEM_DTU_EVENT_TRACE_HH__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "base/types.hh"
+#include "sim/core.hh"
+
+/**
+ * Records the events of a DTU as fixed-size binary records into a file in the output directory.
+ * The records are collected in memory and written in large chunks, so that tracing is cheap
+ * enough to leave it enabled. util/dtu_trace.py analyzes the files.
+ *
+ * The file starts with the magic "DTUTRACE", followed by the version and the record size as
+ * 32-bit integers. All values are stored in little endian.
+ */
+class DtuTrace
+{
+  public:
+
+    static const uint32_t VERSION = 1;
+
+    enum class Event : uint8_t
+    {
+        CMD_START,      // a command has been started in <slot>
+        CMD_FINISH,     // a command has been finished in <slot>; <arg> is its start tick
+        NOC_SEND,       // a packet of <kind> has been sent to <peer>; <arg> is the command start
+        NOC_RECV,       // a packet of <kind> has been received from <peer>; <arg> as above
+        NOC_RESP,       // the response for a packet of <kind> has been received; <arg> as above
+        BUF_ALLOC,      // the transfer buffer <slot> has been allocated for a transfer of <kind>
+        BUF_FREE,       // the transfer buffer <slot> has been freed
+        CREDITS,        // the credits of <ep> have been changed to <size>
+    };
+
+    struct Record
+    {
+        uint64_t tick;
+        uint64_t arg;
+        uint32_t size;
+        uint8_t event;
+        uint8_t coreId;     // the DTU that recorded the event
+        uint8_t epId;
+        uint8_t slot;       // the command slot or buffer id
+        uint8_t peer;       // the remote core
+        uint8_t kind;       // the opcode, NoC packet type or transfer type
+        uint8_t error;
+        uint8_t reserved;
+    } M5_ATTR_PACKED;
+
+  public:
+
+    DtuTrace(const std::string &fileName, unsigned coreId, size_t bufferSize);
+
+    ~DtuTrace();
+
+    /**
+     * Adds a new record for <ev> at the current tick. The remaining fields are zero and can be
+     * filled via the returned reference until the next record is added.
+     */
+    Record &add(Event ev)
+    {
+        if (records.size() == records.capacity())
+            flush();
+
+        records.emplace_back();
+        Record &rec = records.back();
+        rec.tick = curTick();
+        rec.arg = 0;
+        rec.size = 0;
+        rec.event = static_cast<uint8_t>(ev);
+        rec.coreId = coreId;
+        rec.epId = 0;
+        rec.slot = 0;
+        rec.peer = 0;
+        rec.kind = 0;
+        rec.error = 0;
+        rec.reserved = 0;
+        return rec;
+    }
+
+    /**
+     * Writes all collected records to the file
+     */
+    void flush();
+
+    /**
+     * Starts the file afresh in the child of a fork, after the output directory has been changed.
+     * The records collected so far are dropped, because they are written by the parent.
+     */
+    void restart();
+
+  private:
+
+    void writeHeader();
+
+    std::ostream *stream;
+
+    const uint8_t coreId;
+
+    std::vector<Record> records;
+};
+
+#endif
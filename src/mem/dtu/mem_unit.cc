@@ -32,90 +32,369 @@
 #include "debug/DtuBuf.hh"
 #include "debug/DtuPackets.hh"
 #include "debug/DtuSysCalls.hh"
+#include "debug/DtuXfers.hh"
 #include "debug/DtuPower.hh"
 #include "mem/dtu/mem_unit.hh"
 #include "mem/dtu/noc_addr.hh"
 
+MemoryUnit::MemoryUnit(Dtu &_dtu, unsigned cmdQueueSize, unsigned _maxDmaPackets)
+    : dtu(_dtu),
+      maxDmaPackets(_maxDmaPackets),
+      dmas(cmdQueueSize)
+{
+    assert(maxDmaPackets > 0);
+
+    for (unsigned i = 0; i < cmdQueueSize; ++i)
+        dmas[i].continueEvent = new ContinueEvent(*this, i);
+}
+
+MemoryUnit::~MemoryUnit()
+{
+    for (auto &dma : dmas)
+        delete dma.continueEvent;
+}
+
+bool
+MemoryUnit::isIdle() const
+{
+    for (auto &dma : dmas)
+    {
+        if (dma.continueEvent->scheduled())
+            return false;
+    }
+    return true;
+}
+
+void
+MemoryUnit::regStats()
+{
+    readBytes
+        .init(dtu.numEndpoints)
+        .name(name() + ".readBytes")
+        .desc("Number of bytes read from remote memory")
+        .flags(Stats::nozero);
+    writtenBytes
+        .init(dtu.numEndpoints)
+        .name(name() + ".writtenBytes")
+        .desc("Number of bytes written to remote memory")
+        .flags(Stats::nozero);
+    atomics
+        .init(dtu.numEndpoints)
+        .name(name() + ".atomics")
+        .desc("Number of atomic operations on remote memory")
+        .flags(Stats::nozero);
+    segments
+        .init(dtu.numEndpoints)
+        .name(name() + ".segments")
+        .desc("Number of segments transferred by vectored reads/writes")
+        .flags(Stats::nozero);
+    receivedReadBytes
+        .name(name() + ".receivedReadBytes")
+        .desc("Number of bytes other PEs read from us");
+    receivedWriteBytes
+        .name(name() + ".receivedWriteBytes")
+        .desc("Number of bytes other PEs wrote to us");
+    receivedAtomics
+        .name(name() + ".receivedAtomics")
+        .desc("Number of atomic operations other PEs performed on us");
+}
+
+void
+MemoryUnit::initDma(Dtu::Command& cmd, bool read)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    dma.targetCoreId = dtu.regs().get(cmd.epId, EpReg::TGT_COREID);
+    dma.localAddr = cmd.dataAddr;
+    dma.remoteAddr = dtu.regs().get(cmd.epId, EpReg::REQ_REM_ADDR) + cmd.offset;
+    dma.size = cmd.dataSize;
+    dma.issued = 0;
+    dma.completed = 0;
+    dma.inFlight = 0;
+    dma.remoteBase = dma.remoteAddr;
+    dma.segments.clear();
+    dma.listReceived = 0;
+    dma.nextSegment = 0;
+    dma.continueEvent->read = read;
+}
+
+void
+MemoryUnit::startVectored(Dtu::Command& cmd, unsigned flags)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    // DATA_SIZE is the number of descriptors in this case
+    Addr count = cmd.dataSize;
+    Addr listSize = count * sizeof(Dtu::MemDescriptor);
+
+    DPRINTFS(Dtu, (&dtu), "\e[1m[%s -> %u]\e[0m %lu segments at offset %#018lx with EP%u, "
+        "list at %#018lx\n",
+        dma.continueEvent->read ? "rd" : "wr", dma.targetCoreId, count, cmd.offset,
+        cmd.epId, cmd.dataAddr);
+
+    // the limit also prevents that the list size overflows
+    if(!(flags & (dma.continueEvent->read ? Dtu::MemoryFlags::READ : Dtu::MemoryFlags::WRITE)) ||
+       count > Dtu::maxMemDescriptors)
+    {
+        DPRINTFS(Dtu, (&dtu), "Denying vectored access with %lu segments (flags=%#x)\n",
+                 count, flags);
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::NO_PERM);
+        return;
+    }
+
+    if(count == 0)
+    {
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1));
+        return;
+    }
+
+    // fetch the whole list from local memory before the first transfer starts. the requests
+    // must not cross a block boundary
+    dma.segments.resize(count);
+
+    Addr offset = 0;
+    while(offset < listSize)
+    {
+        Addr blockOff = (cmd.dataAddr + offset) & (dtu.blockSize - 1);
+        Addr reqSize = std::min(dtu.blockSize - blockOff, listSize - offset);
+
+        auto pkt = dtu.generateRequest(cmd.dataAddr + offset,
+                                       reqSize,
+                                       MemCmd::ReadReq);
+        offset += reqSize;
+
+        // in atomic mode, the last response completes the list right away
+        dtu.sendMemRequest(pkt,
+                           cmd.slot,
+                           Dtu::MemReqType::DESCRIPTORS,
+                           dtu.transferToMemRequestLatency);
+    }
+}
+
 void
-MemoryUnit::startRead(const Dtu::Command& cmd)
+MemoryUnit::recvDescriptors(Dtu::Command& cmd, PacketPtr pkt)
+{
+    Addr remoteSize = dtu.regs().get(cmd.epId, EpReg::REQ_REM_SIZE);
+    DmaState &dma = dmas[cmd.slot];
+    Addr listSize = dma.segments.size() * sizeof(Dtu::MemDescriptor);
+
+    Addr offset = pkt->getAddr() - cmd.dataAddr;
+    assert(offset + pkt->getSize() <= listSize);
+    memcpy(reinterpret_cast<uint8_t*>(dma.segments.data()) + offset,
+           pkt->getConstPtr<uint8_t>(),
+           pkt->getSize());
+
+    dma.listReceived += pkt->getSize();
+    if(dma.listReceived < listSize)
+        return;
+
+    for (auto &seg : dma.segments)
+    {
+        if(cmd.offset + seg.offset < seg.offset ||
+           seg.size + cmd.offset + seg.offset < seg.size ||
+           seg.size + cmd.offset + seg.offset > remoteSize)
+        {
+            DPRINTFS(Dtu, (&dtu), "Denying segment of %lu bytes at offset %#018lx (size=%#lx)\n",
+                     seg.size, cmd.offset + seg.offset, remoteSize);
+            dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::NO_PERM);
+            return;
+        }
+    }
+
+    if(!startNextSegment(cmd, Cycles(1)))
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1));
+}
+
+bool
+MemoryUnit::startNextSegment(Dtu::Command& cmd, Cycles delay)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    while(dma.nextSegment < dma.segments.size())
+    {
+        const Dtu::MemDescriptor &seg = dma.segments[dma.nextSegment++];
+        if(seg.size == 0)
+            continue;
+
+        DPRINTFS(DtuXfers, (&dtu), "slot%u: segment %lu: %lu bytes at %#018lx <-> %#018lx\n",
+                 cmd.slot, dma.nextSegment - 1, seg.size, dma.remoteBase + seg.offset, seg.addr);
+
+        dma.localAddr = seg.addr;
+        dma.remoteAddr = dma.remoteBase + seg.offset;
+        dma.size = seg.size;
+        dma.issued = 0;
+        dma.completed = 0;
+        segments[cmd.epId]++;
+
+        // the previous segment is complete, so that the event is not scheduled
+        dtu.schedule(dma.continueEvent, dtu.clockEdge(delay));
+        return true;
+    }
+    return false;
+}
+
+void
+MemoryUnit::segmentComplete(Dtu::Command& cmd, Cycles delay)
+{
+    // the command is finished if there is no further segment
+    if(!startNextSegment(cmd, delay))
+        dtu.scheduleFinishOp(cmd.slot, delay);
+}
+
+void
+MemoryUnit::startRead(Dtu::Command& cmd)
 {
-    unsigned targetCoreId = dtu.regs().get(cmd.epId, EpReg::TGT_COREID);
-    Addr localAddr = dtu.regs().get(CmdReg::DATA_ADDR);
-    Addr requestSize = dtu.regs().get(CmdReg::DATA_SIZE);
-    Addr offset = dtu.regs().get(CmdReg::OFFSET);
-    Addr remoteAddr = dtu.regs().get(cmd.epId, EpReg::REQ_REM_ADDR);
     Addr remoteSize = dtu.regs().get(cmd.epId, EpReg::REQ_REM_SIZE);
     unsigned flags = dtu.regs().get(cmd.epId, EpReg::REQ_FLAGS);
 
-    // we'll need that in readComplete
-    continueEvent.cmd = cmd;
-    continueEvent.read = true;
+    initDma(cmd, true);
 
-    requestSize = std::min(dtu.maxNocPacketSize, requestSize);
-    if(requestSize == 0)
+    if(cmd.arg & Dtu::MEM_VECTORED)
+    {
+        startVectored(cmd, flags);
         return;
+    }
+
+    if(cmd.dataSize == 0)
+    {
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1));
+        return;
+    }
 
     DPRINTFS(Dtu, (&dtu), "\e[1m[rd -> %u]\e[0m at offset %#018lx with EP%u into %#018lx:%lu\n",
-        targetCoreId, offset, cmd.epId, localAddr, requestSize);
+        dmas[cmd.slot].targetCoreId, cmd.offset, cmd.epId, cmd.dataAddr, cmd.dataSize);
 
-    // TODO error handling
-    assert(flags & Dtu::MemoryFlags::READ);
-    assert(requestSize + offset >= requestSize);
-    assert(requestSize + offset <= remoteSize);
+    if(!(flags & Dtu::MemoryFlags::READ) ||
+       cmd.dataSize + cmd.offset < cmd.dataSize ||
+       cmd.dataSize + cmd.offset > remoteSize)
+    {
+        DPRINTFS(Dtu, (&dtu), "Denying read of %lu bytes at %#018lx (flags=%#x, size=%#lx)\n",
+                 cmd.dataSize, cmd.offset, flags, remoteSize);
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::NO_PERM);
+        return;
+    }
 
-    auto pkt = dtu.generateRequest(NocAddr(targetCoreId, 0, remoteAddr + offset).getAddr(),
+    issueRead(cmd);
+}
+
+void
+MemoryUnit::issueRead(Dtu::Command& cmd)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    Addr requestSize = std::min(dtu.maxNocPacketSize, dma.size - dma.issued);
+
+    DPRINTFS(DtuXfers, (&dtu), "slot%u: reading %lu bytes at %#018lx (%u in flight)\n",
+             cmd.slot, requestSize, dma.remoteAddr + dma.issued, dma.inFlight + 1);
+
+    auto pkt = dtu.generateRequest(NocAddr(dma.targetCoreId, 0, dma.remoteAddr + dma.issued).getAddr(),
                                    requestSize,
                                    MemCmd::ReadReq);
 
+    dma.issued += requestSize;
+    dma.inFlight++;
+    readBytes[cmd.epId] += requestSize;
+
     dtu.sendNocRequest(Dtu::NocPacketType::READ_REQ,
                        pkt,
-                       dtu.commandToNocRequestLatency);
+                       dtu.commandToNocRequestLatency,
+                       false,
+                       cmd.slot);
+
+    scheduleNextPacket(cmd);
 }
 
 void
-MemoryUnit::startWrite(const Dtu::Command& cmd)
+MemoryUnit::startWrite(Dtu::Command& cmd)
 {
-    unsigned targetCoreId = dtu.regs().get(cmd.epId, EpReg::TGT_COREID);
-    Addr localAddr = dtu.regs().get(CmdReg::DATA_ADDR);
-    Addr requestSize = dtu.regs().get(CmdReg::DATA_SIZE);
-    Addr offset = dtu.regs().get(CmdReg::OFFSET);
     unsigned flags = dtu.regs().get(cmd.epId, EpReg::REQ_FLAGS);
-
-    Addr targetAddr = dtu.regs().get(cmd.epId, EpReg::REQ_REM_ADDR);
     Addr remoteSize = dtu.regs().get(cmd.epId, EpReg::REQ_REM_SIZE);
 
-    // we'll need that in writeComplete
-    continueEvent.cmd = cmd;
-    continueEvent.read = false;
+    initDma(cmd, false);
+
+    if(cmd.arg & Dtu::MEM_VECTORED)
+    {
+        startVectored(cmd, flags);
+        return;
+    }
 
-    requestSize = std::min(dtu.maxNocPacketSize, requestSize);
-    if(requestSize == 0)
+    if(cmd.dataSize == 0)
+    {
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1));
         return;
+    }
 
     DPRINTFS(Dtu, (&dtu), "\e[1m[wr -> %u]\e[0m at offset %#018lx with EP%u from %#018lx:%lu\n",
-        targetCoreId, offset, cmd.epId, localAddr, requestSize);
+        dmas[cmd.slot].targetCoreId, cmd.offset, cmd.epId, cmd.dataAddr, cmd.dataSize);
 
-    // TODO error handling
-    assert(flags & Dtu::MemoryFlags::WRITE);
-    assert(requestSize + offset >= requestSize);
-    assert(requestSize + offset <= remoteSize);
+    if(!(flags & Dtu::MemoryFlags::WRITE) ||
+       cmd.dataSize + cmd.offset < cmd.dataSize ||
+       cmd.dataSize + cmd.offset > remoteSize)
+    {
+        DPRINTFS(Dtu, (&dtu), "Denying write of %lu bytes at %#018lx (flags=%#x, size=%#lx)\n",
+                 cmd.dataSize, cmd.offset, flags, remoteSize);
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::NO_PERM);
+        return;
+    }
+
+    issueWrite(cmd);
+}
+
+void
+MemoryUnit::issueWrite(Dtu::Command& cmd)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    Addr requestSize = std::min(dtu.maxNocPacketSize, dma.size - dma.issued);
+
+    DPRINTFS(DtuXfers, (&dtu), "slot%u: writing %lu bytes to %#018lx (%u in flight)\n",
+             cmd.slot, requestSize, dma.remoteAddr + dma.issued, dma.inFlight + 1);
+
+    Addr localAddr = dma.localAddr + dma.issued;
+    NocAddr remoteAddr(dma.targetCoreId, 0, dma.remoteAddr + dma.issued);
+
+    dma.issued += requestSize;
+    dma.inFlight++;
+    writtenBytes[cmd.epId] += requestSize;
 
     dtu.startTransfer(Dtu::TransferType::LOCAL_READ,
-                      NocAddr(targetCoreId, 0, targetAddr + offset),
+                      remoteAddr,
                       localAddr,
-                      requestSize);
+                      requestSize,
+                      NULL,
+                      NULL,
+                      Cycles(0),
+                      cmd.slot);
+
+    scheduleNextPacket(cmd);
 }
 
 void
-MemoryUnit::readComplete(PacketPtr pkt)
+MemoryUnit::scheduleNextPacket(Dtu::Command& cmd)
 {
+    DmaState &dma = dmas[cmd.slot];
+
+    // send the next packet in the next cycle, if the window permits it
+    if(dma.issued < dma.size &&
+       dma.inFlight < maxDmaPackets &&
+       !dma.continueEvent->scheduled())
+    {
+        dtu.schedule(dma.continueEvent, dtu.clockEdge(Cycles(1)));
+    }
+}
+
+void
+MemoryUnit::readComplete(Dtu::Command& cmd, PacketPtr pkt)
+{
+    DmaState &dma = dmas[cmd.slot];
+
     dtu.printPacket(pkt);
 
-    Addr localAddr = dtu.regs().get(CmdReg::DATA_ADDR);
-    Addr requestSize = dtu.regs().get(CmdReg::DATA_SIZE);
-    Addr offset = dtu.regs().get(CmdReg::OFFSET);
+    assert(dma.inFlight > 0);
+    dma.inFlight--;
 
-    requestSize -= pkt->getSize();
+    // the responses might arrive out of order, so determine the position from the address
+    Addr localAddr = dma.localAddr + NocAddr(pkt->getAddr()).offset - dma.remoteAddr;
 
     // since the transfer is done in steps, we can start after the header delay here
     Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
@@ -127,49 +406,211 @@ MemoryUnit::readComplete(PacketPtr pkt)
                       pkt,
                       NULL,
                       delay,
-                      requestSize == 0);
+                      cmd.slot);
 
-    if(requestSize > 0)
-    {
-        dtu.regs().set(CmdReg::DATA_SIZE, requestSize);
-        dtu.regs().set(CmdReg::DATA_ADDR, localAddr + pkt->getSize());
-        dtu.regs().set(CmdReg::OFFSET, offset + pkt->getSize());
+    scheduleNextPacket(cmd);
+}
 
-        // transfer the next packet
-        dtu.schedule(continueEvent, dtu.clockEdge(Cycles(1)));
-    }
+void
+MemoryUnit::localWriteComplete(Dtu::Command& cmd, Addr size)
+{
+    DmaState &dma = dmas[cmd.slot];
+
+    dma.completed += size;
+    assert(dma.completed <= dma.size);
+
+    // the segment is finished as soon as all packets are in local memory
+    if(dma.completed == dma.size)
+        segmentComplete(cmd, Cycles(1));
 }
 
 void
-MemoryUnit::writeComplete(PacketPtr pkt)
+MemoryUnit::writeComplete(Dtu::Command& cmd, PacketPtr pkt)
 {
-    Addr requestSize = dtu.regs().get(CmdReg::DATA_SIZE);
+    DmaState &dma = dmas[cmd.slot];
 
-    // write finished or if requestSize < pkt->getSize(), it was a message
-    if(requestSize <= pkt->getSize())
+    assert(dma.inFlight > 0);
+    dma.inFlight--;
+    dma.completed += pkt->getSize();
+    assert(dma.completed <= dma.size);
+
+    // the segment is finished if all packets have been acknowledged
+    if(dma.completed == dma.size)
     {
-        // we don't need to pay the payload delay here because the message basically has no payload
-        // since we only receive an ACK back for writing
         Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
-        dtu.scheduleFinishOp(delay);
+        segmentComplete(cmd, delay);
     }
-    // write needs to be continued
-    else if(requestSize > pkt->getSize())
+    // otherwise, the write needs to be continued
+    else
+        scheduleNextPacket(cmd);
+
+    dtu.freeRequest(pkt);
+}
+
+void
+MemoryUnit::accessLocal(Addr addr, void *data, unsigned size, bool write)
+{
+    auto pkt = dtu.generateRequest(addr, size, write ? MemCmd::WriteReq : MemCmd::ReadReq);
+
+    if (write)
+        memcpy(pkt->getPtr<uint8_t>(), data, size);
+
+    dtu.sendFunctionalMemRequest(pkt);
+
+    if (!write)
+        memcpy(data, pkt->getConstPtr<uint8_t>(), size);
+
+    dtu.freeRequest(pkt);
+}
+
+void
+MemoryUnit::startAtomic(Dtu::Command& cmd)
+{
+    Addr remoteSize = dtu.regs().get(cmd.epId, EpReg::REQ_REM_SIZE);
+    unsigned flags = dtu.regs().get(cmd.epId, EpReg::REQ_FLAGS);
+
+    initDma(cmd, false);
+
+    DmaState &dma = dmas[cmd.slot];
+
+    auto op = static_cast<Dtu::AtomicOp>(cmd.arg & Dtu::ATOMIC_OP_MASK);
+    unsigned size = (cmd.arg & Dtu::ATOMIC_64BIT) ? 8 : 4;
+
+    DPRINTFS(Dtu, (&dtu), "\e[1m[at -> %u]\e[0m op %u on %u bytes at offset %#018lx with EP%u "
+        "using %#018lx\n",
+        dma.targetCoreId, static_cast<unsigned>(op), size, cmd.offset, cmd.epId, cmd.dataAddr);
+
+    bool validOp = op == Dtu::AtomicOp::FETCH_ADD ||
+                   op == Dtu::AtomicOp::CAS ||
+                   op == Dtu::AtomicOp::SWAP;
+    bool aligned = (dma.remoteAddr & (size - 1)) == 0;
+
+    // the operation reads and writes the remote word, which needs to be naturally aligned
+    if(!validOp || !aligned ||
+       !(flags & Dtu::MemoryFlags::READ) || !(flags & Dtu::MemoryFlags::WRITE) ||
+       cmd.offset + size < cmd.offset || cmd.offset + size > remoteSize)
     {
-        Addr localAddr = dtu.regs().get(CmdReg::DATA_ADDR);
-        Addr offset = dtu.regs().get(CmdReg::OFFSET);
+        DPRINTFS(Dtu, (&dtu), "Denying atomic op %u at offset %#018lx (flags=%#x, size=%#lx)\n",
+                 static_cast<unsigned>(op), cmd.offset, flags, remoteSize);
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::NO_PERM);
+        return;
+    }
+
+    auto pkt = dtu.generateRequest(NocAddr(dma.targetCoreId, 0, dma.remoteAddr).getAddr(),
+                                   sizeof(Dtu::AtomicRequest),
+                                   MemCmd::SwapReq);
 
-        dtu.regs().set(CmdReg::DATA_SIZE, requestSize - pkt->getSize());
-        dtu.regs().set(CmdReg::DATA_ADDR, localAddr + pkt->getSize());
-        dtu.regs().set(CmdReg::OFFSET, offset + pkt->getSize());
+    // the operands are in local memory: the operand, followed by the expected value for CAS
+    auto areq = pkt->getPtr<Dtu::AtomicRequest>();
+    areq->op = static_cast<uint8_t>(op);
+    areq->size = size;
+    areq->operand = 0;
+    areq->expected = 0;
+    accessLocal(cmd.dataAddr, &areq->operand, size, false);
+    if(op == Dtu::AtomicOp::CAS)
+        accessLocal(cmd.dataAddr + size, &areq->expected, size, false);
+
+    atomics[cmd.epId]++;
+
+    dtu.sendNocRequest(Dtu::NocPacketType::ATOMIC_REQ,
+                       pkt,
+                       dtu.commandToNocRequestLatency + dtu.transferToMemRequestLatency,
+                       false,
+                       cmd.slot);
+}
+
+void
+MemoryUnit::atomicComplete(Dtu::Command& cmd, PacketPtr pkt)
+{
+    Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
 
-        // transfer the next packet
-        dtu.schedule(continueEvent, dtu.clockEdge(Cycles(1)));
+    if(pkt->isError())
+    {
+        dtu.scheduleFinishOp(cmd.slot, delay, Dtu::Error::NO_PERM);
+        dtu.freeRequest(pkt);
+        return;
     }
 
+    // the old value replaces the operand in local memory
+    auto areq = pkt->getPtr<Dtu::AtomicRequest>();
+    accessLocal(cmd.dataAddr, &areq->operand, areq->size, true);
+
+    DPRINTFS(Dtu, (&dtu), "Atomic operation returned %#018lx\n", areq->operand);
+
+    dtu.scheduleFinishOp(cmd.slot, delay + dtu.transferToMemRequestLatency);
     dtu.freeRequest(pkt);
 }
 
+void
+MemoryUnit::recvAtomicFromNoc(PacketPtr pkt)
+{
+    Addr localAddr = NocAddr(pkt->getAddr()).offset;
+    auto areq = pkt->getPtr<Dtu::AtomicRequest>();
+
+    DPRINTFS(Dtu, (&dtu), "\e[1m[at <- ?]\e[0m op %u on %#018lx:%u\n",
+        areq->op, localAddr, areq->size);
+
+    pkt->makeResponse();
+
+    // the registers can't be changed atomically. the request comes from another DTU, so don't
+    // trust it: the word needs to have a valid size and to be naturally aligned
+    if(localAddr >= dtu.regFileBaseAddr ||
+       (areq->size != 4 && areq->size != 8) ||
+       (localAddr & (areq->size - 1)) != 0)
+        pkt->setBadAddress();
+    else
+    {
+        // the read and the write are functional, so that nobody else can access the word in
+        // between. the latency of both accesses is accounted for below.
+        uint64_t mask = areq->size == 8 ? ~static_cast<uint64_t>(0)
+                                        : (static_cast<uint64_t>(1) << 32) - 1;
+        uint64_t old = 0;
+        accessLocal(localAddr, &old, areq->size, false);
+
+        uint64_t val = areq->operand & mask;
+        bool valid = true;
+        bool write = true;
+        switch(static_cast<Dtu::AtomicOp>(areq->op))
+        {
+        case Dtu::AtomicOp::FETCH_ADD:
+            val = (old + areq->operand) & mask;
+            break;
+        case Dtu::AtomicOp::CAS:
+            write = old == (areq->expected & mask);
+            break;
+        case Dtu::AtomicOp::SWAP:
+            break;
+        default:
+            pkt->setBadAddress();
+            valid = write = false;
+            break;
+        }
+
+        if(write)
+            accessLocal(localAddr, &val, areq->size, true);
+
+        if(valid)
+        {
+            areq->operand = old;
+            receivedAtomics++;
+        }
+    }
+
+    if (!dtu.atomicMode)
+    {
+        Cycles delay = dtu.ticksToCycles(pkt->headerDelay + pkt->payloadDelay);
+        delay += dtu.nocToTransferLatency;
+        delay += Cycles(dtu.transferToMemRequestLatency * 2);
+        delay += dtu.transferToNocLatency;
+
+        pkt->headerDelay = 0;
+        pkt->payloadDelay = 0;
+
+        dtu.schedNocRequestFinished(dtu.clockEdge(Cycles(1)));
+        dtu.schedNocResponse(pkt, dtu.clockEdge(delay));
+    }
+}
+
 void
 MemoryUnit::recvFunctionalFromNoc(PacketPtr pkt)
 {
@@ -206,6 +647,11 @@ MemoryUnit::recvFromNoc(PacketPtr pkt)
         Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
         pkt->headerDelay = 0;
 
+        if (pkt->isWrite())
+            receivedWriteBytes += pkt->getSize();
+        else
+            receivedReadBytes += pkt->getSize();
+
         auto type = pkt->isWrite() ? Dtu::TransferType::REMOTE_WRITE : Dtu::TransferType::REMOTE_READ;
         dtu.startTransfer(type,
                           NocAddr(0, 0),                    // remote address is irrelevant
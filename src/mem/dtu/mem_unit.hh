@@ -31,6 +31,7 @@
 #ifndef __MEM_DTU_MEM_UNIT_HH__
 #define __MEM_DTU_MEM_UNIT_HH__
 
+#include "base/statistics.hh"
 #include "mem/dtu/dtu.hh"
 
 class MemoryUnit
@@ -41,20 +42,21 @@ class MemoryUnit
     {
         MemoryUnit& memUnit;
 
-        Dtu::Command cmd;
+        unsigned cmdSlot;
 
         bool read;
 
-        ContinueEvent(MemoryUnit& _memUnit)
-            : memUnit(_memUnit), cmd(), read()
+        ContinueEvent(MemoryUnit& _memUnit, unsigned _cmdSlot)
+            : memUnit(_memUnit), cmdSlot(_cmdSlot), read()
         {}
 
         void process() override
         {
+            Dtu::Command& cmd = memUnit.dtu.getCommand(cmdSlot);
             if(read)
-                memUnit.startRead(cmd);
+                memUnit.issueRead(cmd);
             else
-                memUnit.startWrite(cmd);
+                memUnit.issueWrite(cmd);
         }
 
         const char* description() const override { return "ContinueEvent"; }
@@ -62,29 +64,85 @@ class MemoryUnit
         const std::string name() const override { return memUnit.dtu.name(); }
     };
 
+    /**
+     * The state of a READ/WRITE command, which is split into NoC packets of at most
+     * maxNocPacketSize bytes. Up to maxDmaPackets of them are in flight at once.
+     */
+    struct DmaState
+    {
+        unsigned targetCoreId;
+        // the contiguous region that is currently transferred
+        Addr localAddr;
+        Addr remoteAddr;
+        Addr size;
+        // the number of bytes for which we have sent a request
+        Addr issued;
+        // the number of bytes that have been completely transferred
+        Addr completed;
+        unsigned inFlight;
+        // the descriptor list of a vectored command; the entries are transferred one by one
+        Addr remoteBase;
+        std::vector<Dtu::MemDescriptor> segments;
+        // the number of bytes of the descriptor list that have been read from local memory
+        Addr listReceived;
+        size_t nextSegment;
+        ContinueEvent *continueEvent;
+    };
+
   public:
 
-    MemoryUnit(Dtu &_dtu) : dtu(_dtu), continueEvent(*this) {}
+    MemoryUnit(Dtu &_dtu, unsigned cmdQueueSize, unsigned _maxDmaPackets);
+
+    ~MemoryUnit();
+
+    const std::string name() const { return dtu.name() + ".mem"; }
+
+    void regStats();
+
+    /**
+     * True if no DMA waits to send its next packet
+     */
+    bool isIdle() const;
 
     /**
      * Starts a read -> NoC request
      */
-    void startRead(const Dtu::Command& cmd);
+    void startRead(Dtu::Command& cmd);
     
     /**
      * Starts a write -> Mem request
      */
-    void startWrite(const Dtu::Command& cmd);
+    void startWrite(Dtu::Command& cmd);
 
     /**
      * Read: response from remote DTU
      */
-    void readComplete(PacketPtr pkt);
+    void readComplete(Dtu::Command& cmd, PacketPtr pkt);
+
+    /**
+     * Read: the data of one packet has been written to local memory
+     */
+    void localWriteComplete(Dtu::Command& cmd, Addr size);
 
     /**
      * Write: response from remote DTU
      */
-    void writeComplete(PacketPtr pkt);
+    void writeComplete(Dtu::Command& cmd, PacketPtr pkt);
+
+    /**
+     * Starts an atomic operation on a word in remote memory -> NoC request
+     */
+    void startAtomic(Dtu::Command& cmd);
+
+    /**
+     * Atomic: response with the old value from remote DTU
+     */
+    void atomicComplete(Dtu::Command& cmd, PacketPtr pkt);
+
+    /**
+     * Vectored read/write: a part of the descriptor list has been read from local memory
+     */
+    void recvDescriptors(Dtu::Command& cmd, PacketPtr pkt);
 
 
     /**
@@ -97,11 +155,45 @@ class MemoryUnit
      */
     void recvFromNoc(PacketPtr pkt);
 
+    /**
+     * Received atomic request from NoC -> performed on local memory
+     */
+    void recvAtomicFromNoc(PacketPtr pkt);
+
+  private:
+
+    void initDma(Dtu::Command& cmd, bool read);
+
+    void startVectored(Dtu::Command& cmd, unsigned flags);
+
+    bool startNextSegment(Dtu::Command& cmd, Cycles delay);
+
+    void segmentComplete(Dtu::Command& cmd, Cycles delay);
+
+    void issueRead(Dtu::Command& cmd);
+
+    void issueWrite(Dtu::Command& cmd);
+
+    void scheduleNextPacket(Dtu::Command& cmd);
+
+    void accessLocal(Addr addr, void *data, unsigned size, bool write);
+
   private:
 
     Dtu &dtu;
 
-    ContinueEvent continueEvent;
+    const unsigned maxDmaPackets;
+
+    // one per command slot, because multiple memory commands might be in flight
+    std::vector<DmaState> dmas;
+
+    Stats::Vector readBytes;
+    Stats::Vector writtenBytes;
+    Stats::Vector atomics;
+    Stats::Vector segments;
+    Stats::Scalar receivedReadBytes;
+    Stats::Scalar receivedWriteBytes;
+    Stats::Scalar receivedAtomics;
 };
 
 #endif
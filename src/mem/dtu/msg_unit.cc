@@ -28,6 +28,9 @@
  * policies, either expressed or implied, of the FreeBSD Project.
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include "debug/Dtu.hh"
 #include "debug/DtuBuf.hh"
 #include "debug/DtuCredits.hh"
@@ -56,73 +59,196 @@ static const char *syscallNames[] = {
     "NOOP",
 };
 
+MessageUnit::MessageUnit(Dtu &_dtu, unsigned cmdQueueSize, unsigned _maxRetries, Cycles _retryDelay)
+    : dtu(_dtu),
+      maxRetries(_maxRetries),
+      retryDelay(_retryDelay),
+      replyHeaders(cmdQueueSize),
+      retries(cmdQueueSize),
+      multicasts(cmdQueueSize),
+      creditStallStart(_dtu.numEndpoints, MaxTick)
+{
+    for (unsigned i = 0; i < cmdQueueSize; ++i)
+    {
+        retries[i].attempts = 0;
+        retries[i].pkt = NULL;
+        retries[i].event = new RetryEvent(*this, i);
+    }
+}
+
+MessageUnit::~MessageUnit()
+{
+    for (auto &retry : retries)
+        delete retry.event;
+}
+
+bool
+MessageUnit::isIdle() const
+{
+    for (auto &retry : retries)
+    {
+        if (retry.event->scheduled())
+            return false;
+    }
+    return true;
+}
+
+void
+MessageUnit::regStats()
+{
+    sentMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".sentMsgs")
+        .desc("Number of sent messages (including replies)")
+        .flags(Stats::nozero);
+    sentBytes
+        .init(dtu.numEndpoints)
+        .name(name() + ".sentBytes")
+        .desc("Number of sent bytes (including the header)")
+        .flags(Stats::nozero);
+    multicastMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".multicastMsgs")
+        .desc("Number of messages sent to a group of cores (counted once per group)")
+        .flags(Stats::nozero);
+    receivedMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".receivedMsgs")
+        .desc("Number of received messages (including replies)")
+        .flags(Stats::nozero);
+    receivedBytes
+        .init(dtu.numEndpoints)
+        .name(name() + ".receivedBytes")
+        .desc("Number of received bytes (including the header)")
+        .flags(Stats::nozero);
+    msgLatency
+        .init(16)
+        .name(name() + ".msgLatency")
+        .desc("Cycles from starting the SEND/REPLY command until the message arrived here")
+        .flags(Stats::nozero);
+    creditStalls
+        .init(dtu.numEndpoints)
+        .name(name() + ".creditStalls")
+        .desc("Number of messages that could not be sent due to missing credits")
+        .flags(Stats::nozero);
+    creditStallCycles
+        .init(dtu.numEndpoints)
+        .name(name() + ".creditStallCycles")
+        .desc("Cycles from a failed send due to missing credits until credits were received")
+        .flags(Stats::nozero);
+    rejectedMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".rejectedMsgs")
+        .desc("Number of received messages rejected because the receive buffer was full")
+        .flags(Stats::nozero);
+    retriedMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".retriedMsgs")
+        .desc("Number of times a rejected message has been sent again")
+        .flags(Stats::nozero);
+    failedMsgs
+        .init(dtu.numEndpoints)
+        .name(name() + ".failedMsgs")
+        .desc("Number of messages that could not be sent (missing credits or rejected)")
+        .flags(Stats::nozero);
+}
+
 void
 MessageUnit::startTransmission(const Dtu::Command& cmd)
 {
     unsigned epid = cmd.epId;
 
+    Multicast &mc = multicasts[cmd.slot];
+    mc.targets.clear();
+
     // if we want to reply, request the header first
     if(cmd.opcode == Dtu::CommandOpcode::REPLY)
     {
-        offset = 0;
-        requestHeader(cmd.epId);
+        ReplyHeader &reply = replyHeaders[cmd.slot];
+        reply.offset = 0;
+        reply.msgAddr = dtu.regs().get(epid, EpReg::BUF_RD_PTR);
+        requestHeader(cmd);
+        return;
+    }
+
+    RegFile::reg_t targetCoreId = dtu.regs().get(epid, EpReg::TGT_COREID);
+    if (!getTargets(targetCoreId, mc.targets))
+    {
+        DPRINTFS(Dtu, (&dtu), "EP%u: invalid multicast targets (%#018lx)\n", epid, targetCoreId);
+        failedMsgs[epid]++;
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::INV_TARGET);
         return;
     }
 
-    // check if we have enough credits
-    Addr messageSize = dtu.regs().get(CmdReg::DATA_SIZE);
+    if ((targetCoreId & (Dtu::MULTICAST_RANGE | Dtu::MULTICAST_BITMAP)) && mc.targets.empty())
+    {
+        DPRINTFS(Dtu, (&dtu), "EP%u: multicast without targets (%#018lx)\n", epid, targetCoreId);
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1));
+        return;
+    }
+
+    // check if we have enough credits; a multicast pays for each target
+    unsigned copies = std::max<size_t>(mc.targets.size(), 1);
+    Addr messageSize = cmd.dataSize;
     Addr maxMessageSize = dtu.regs().get(epid, EpReg::MAX_MSG_SIZE);
     unsigned credits = dtu.regs().get(epid, EpReg::CREDITS);
 
     // TODO error handling
     assert(messageSize + sizeof(Dtu::MessageHeader) <= maxMessageSize);
 
-    if (credits < maxMessageSize)
+    if (credits < maxMessageSize * copies)
     {
-        warn("pe%u.ep%u: Ignore send message command because there are not "
-             "enough credits", dtu.coreId, epid);
-        dtu.scheduleFinishOp(Cycles(1));
+        DPRINTFS(DtuCredits, (&dtu), "EP%u: not enough credits to send message (%u < %u)\n",
+                 epid, credits, maxMessageSize * copies);
+        mc.targets.clear();
+        failedMsgs[epid]++;
+        creditStalls[epid]++;
+        if (creditStallStart[epid] == MaxTick)
+            creditStallStart[epid] = curTick();
+        dtu.scheduleFinishOp(cmd.slot, Cycles(1), Dtu::Error::MISS_CREDITS);
         return;
     }
 
-    credits -= maxMessageSize;
+    credits -= maxMessageSize * copies;
 
     DPRINTFS(DtuCredits, (&dtu), "EP%u pays %u credits (%u left)\n",
-             epid, maxMessageSize, credits);
+             epid, maxMessageSize * copies, credits);
 
     // pay the credits
-    dtu.regs().set(epid, EpReg::CREDITS, credits);
+    updateCredits(epid, credits);
 
     // fill the info struct and start the transfer
-    info.targetCoreId = dtu.regs().get(epid, EpReg::TGT_COREID);
+    MsgInfo info;
+    info.targetCoreId = mc.targets.empty() ? targetCoreId : mc.targets[0];
     info.targetEpId   = dtu.regs().get(epid, EpReg::TGT_EPID);
     info.label        = dtu.regs().get(epid, EpReg::LABEL);
-    info.replyLabel   = dtu.regs().get(CmdReg::REPLY_LABEL);
-    info.replyEpId    = dtu.regs().get(CmdReg::REPLY_EPID);
+    info.replyLabel   = cmd.replyLabel;
+    info.replyEpId    = cmd.replyEpId;
     info.ready = true;
 
-    startXfer(cmd);
+    startXfer(cmd, info);
 }
 
 void
-MessageUnit::requestHeader(unsigned epid)
+MessageUnit::requestHeader(const Dtu::Command& cmd)
 {
-    assert(offset < sizeof(Dtu::MessageHeader));
+    ReplyHeader &reply = replyHeaders[cmd.slot];
 
-    Addr msgAddr = dtu.regs().get(epid, EpReg::BUF_RD_PTR);
+    assert(reply.offset < sizeof(Dtu::MessageHeader));
 
     DPRINTFS(DtuBuf, (&dtu), "EP%d: requesting header for reply on message @ %p\n",
-             epid, msgAddr + offset);
+             cmd.epId, reply.msgAddr + reply.offset);
 
     // take care that we might need 2 loads to request the header
-    Addr blockOff = (msgAddr + offset) & (dtu.blockSize - 1);
-    Addr reqSize = std::min(dtu.blockSize - blockOff, sizeof(Dtu::MessageHeader) - offset);
+    Addr blockOff = (reply.msgAddr + reply.offset) & (dtu.blockSize - 1);
+    Addr reqSize = std::min(dtu.blockSize - blockOff,
+                            sizeof(Dtu::MessageHeader) - reply.offset);
 
-    auto pkt = dtu.generateRequest(msgAddr + offset,
+    auto pkt = dtu.generateRequest(reply.msgAddr + reply.offset,
                                    reqSize,
                                    MemCmd::ReadReq);
     dtu.sendMemRequest(pkt,
-                       epid,
+                       cmd.slot,
                        Dtu::MemReqType::HEADER,
                        Cycles(1));
 }
@@ -130,22 +256,28 @@ MessageUnit::requestHeader(unsigned epid)
 void
 MessageUnit::recvFromMem(const Dtu::Command& cmd, PacketPtr pkt)
 {
+    ReplyHeader &reply = replyHeaders[cmd.slot];
+    Dtu::MessageHeader &header = reply.header;
+
     // simply collect the header in a member for simplicity
-    assert(offset + pkt->getSize() <= sizeof(header));
-    memcpy(reinterpret_cast<char*>(&header) + offset, pkt->getPtr<char*>(), pkt->getSize());
+    assert(reply.offset + pkt->getSize() <= sizeof(header));
+    memcpy(reinterpret_cast<char*>(&header) + reply.offset,
+           pkt->getPtr<char*>(),
+           pkt->getSize());
 
-    offset += pkt->getSize();
+    reply.offset += pkt->getSize();
 
     // do we have the complete header yet? if not, request the rest
-    if(offset < sizeof(Dtu::MessageHeader))
+    if(reply.offset < sizeof(Dtu::MessageHeader))
     {
-        requestHeader(cmd.epId);
+        requestHeader(cmd);
         return;
     }
 
     // now that we have the header, fill the info struct
     assert(header.flags & Dtu::REPLY_ENABLED);
 
+    MsgInfo info;
     info.targetCoreId = header.senderCoreId;
     info.targetEpId   = header.replyEpId;  // send message to the reply EP
     info.replyEpId    = header.senderEpId; // and grant credits to the sender
@@ -158,8 +290,7 @@ MessageUnit::recvFromMem(const Dtu::Command& cmd, PacketPtr pkt)
 
     // disable replies for this message
     // use a functional request here because we don't need to wait for it anyway
-    Addr msgAddr = dtu.regs().get(cmd.epId, EpReg::BUF_RD_PTR);
-    auto hpkt = dtu.generateRequest(msgAddr,
+    auto hpkt = dtu.generateRequest(reply.msgAddr,
                                     sizeof(header.flags),
                                     MemCmd::WriteReq);
     header.flags &= ~Dtu::REPLY_ENABLED;
@@ -168,20 +299,20 @@ MessageUnit::recvFromMem(const Dtu::Command& cmd, PacketPtr pkt)
     dtu.freeRequest(hpkt);
 
     // now start the transfer
-    startXfer(cmd);
+    startXfer(cmd, info);
 }
 
 void
-MessageUnit::startXfer(const Dtu::Command& cmd)
+MessageUnit::startXfer(const Dtu::Command& cmd, MsgInfo& info)
 {
     assert(info.ready);
 
-    Addr messageAddr = dtu.regs().get(CmdReg::DATA_ADDR);
-    Addr messageSize = dtu.regs().get(CmdReg::DATA_SIZE);
+    Addr messageAddr = cmd.dataAddr;
+    Addr messageSize = cmd.dataSize;
 
     DPRINTFS(Dtu, (&dtu), "\e[1m[%s -> %u]\e[0m with EP%u of %#018lx:%lu\n",
              cmd.opcode == Dtu::CommandOpcode::REPLY ? "rp" : "sd",
-             info.targetCoreId, cmd.epId, dtu.regs().get(CmdReg::DATA_ADDR), messageSize);
+             info.targetCoreId, cmd.epId, messageAddr, messageSize);
 
     DPRINTFS(Dtu, (&dtu), "  header: tgtEP=%u, lbl=%#018lx, rpLbl=%#018lx, rpEP=%u\n",
              info.targetEpId, info.label, info.replyLabel, info.replyEpId);
@@ -202,6 +333,23 @@ MessageUnit::startXfer(const Dtu::Command& cmd)
 
     assert(messageSize + sizeof(Dtu::MessageHeader) <= dtu.maxNocPacketSize);
 
+    retries[cmd.slot].attempts = 0;
+
+    Multicast &mc = multicasts[cmd.slot];
+    if (!mc.targets.empty())
+    {
+        DPRINTFS(Dtu, (&dtu), "  multicast to %u cores (%u..%u)\n",
+                 mc.targets.size(), mc.targets.front(), mc.targets.back());
+
+        mc.attempts.assign(mc.targets.size(), 0);
+        mc.failed = 0;
+        multicastMsgs[cmd.epId]++;
+    }
+
+    unsigned copies = std::max<size_t>(mc.targets.size(), 1);
+    sentMsgs[cmd.epId] += copies;
+    sentBytes[cmd.epId] += copies * (messageSize + sizeof(Dtu::MessageHeader));
+
     // start the transfer of the payload
     dtu.startTransfer(Dtu::TransferType::LOCAL_READ,
                       NocAddr(info.targetCoreId, info.targetEpId),
@@ -209,32 +357,335 @@ MessageUnit::startXfer(const Dtu::Command& cmd)
                       messageSize,
                       NULL,
                       header,
-                      dtu.startMsgTransferDelay);
+                      dtu.startMsgTransferDelay,
+                      cmd.slot);
 
     info.ready = false;
 }
 
+bool
+MessageUnit::getTargets(RegFile::reg_t tgtCoreId, std::vector<unsigned> &targets) const
+{
+    targets.clear();
+
+    if (tgtCoreId & Dtu::MULTICAST_RANGE)
+    {
+        unsigned first = tgtCoreId & 0xFFFF;
+        unsigned last = (tgtCoreId >> 16) & 0xFFFF;
+        if (first > last || last > Dtu::maxCoreId)
+            return false;
+
+        for (unsigned core = first; core <= last; ++core)
+            targets.push_back(core);
+    }
+    else if (tgtCoreId & Dtu::MULTICAST_BITMAP)
+    {
+        for (unsigned core = 0; core < Dtu::numBitmapCores; ++core)
+        {
+            if (tgtCoreId & (static_cast<RegFile::reg_t>(1) << core))
+                targets.push_back(core);
+        }
+    }
+    return true;
+}
+
+void
+MessageUnit::sendMessage(PacketPtr pkt, Cycles delay, unsigned cmdSlot)
+{
+    Multicast &mc = multicasts[cmdSlot];
+
+    if (mc.targets.empty())
+    {
+        dtu.sendNocRequest(Dtu::NocPacketType::MESSAGE, pkt, delay, false, cmdSlot);
+        return;
+    }
+
+    // the packet goes to the first target; the copies for the others share its payload. the
+    // original is sent last, because the copies are completed immediately in atomic mode.
+    auto dpkt = static_cast<Dtu::DtuPacket*>(pkt);
+    unsigned epId = NocAddr(pkt->getAddr()).epId;
+
+    mc.pending = mc.targets.size();
+
+    for (size_t i = 1; i < mc.targets.size(); ++i)
+    {
+        auto copy = dtu.generateRequest(NocAddr(mc.targets[i], epId).getAddr(),
+                                        pkt->getSize(),
+                                        MemCmd::WriteReq,
+                                        pkt->getPtr<uint8_t>(),
+                                        dpkt->payload);
+        copy->payloadDelay = pkt->payloadDelay;
+        dtu.sendNocRequest(Dtu::NocPacketType::MESSAGE, copy, delay, false, cmdSlot);
+    }
+
+    dtu.sendNocRequest(Dtu::NocPacketType::MESSAGE, pkt, delay, false, cmdSlot);
+}
+
+void
+MessageUnit::finishMulticast(const Dtu::Command& cmd, PacketPtr pkt)
+{
+    Multicast &mc = multicasts[cmd.slot];
+
+    Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
+
+    unsigned coreId = NocAddr(pkt->getAddr()).coreId;
+    auto it = std::lower_bound(mc.targets.begin(), mc.targets.end(), coreId);
+    assert(it != mc.targets.end() && *it == coreId);
+    unsigned &attempts = mc.attempts[it - mc.targets.begin()];
+
+    if (pkt->isError())
+    {
+        // retry the target that rejected the message like we do for single messages
+        if (attempts < maxRetries)
+        {
+            attempts++;
+            retriedMsgs[cmd.epId]++;
+
+            auto dpkt = static_cast<Dtu::DtuPacket*>(pkt);
+            auto rpkt = dtu.generateRequest(pkt->getAddr(),
+                                            pkt->getSize(),
+                                            MemCmd::WriteReq,
+                                            pkt->getPtr<uint8_t>(),
+                                            dpkt->payload);
+
+            delay += Cycles(retryDelay << (attempts - 1));
+
+            DPRINTFS(DtuBuf, (&dtu),
+                     "EP%u: message rejected by core %u; retry %u of %u in %lu cycles\n",
+                     cmd.epId, coreId, attempts, maxRetries, static_cast<uint64_t>(delay));
+
+            dtu.schedule(new MulticastRetryEvent(*this, rpkt, cmd.slot), dtu.clockEdge(delay));
+            dtu.freeRequest(pkt);
+            return;
+        }
+
+        DPRINTFS(DtuBuf, (&dtu), "EP%u: message rejected by core %u; giving up after %u retries\n",
+                 cmd.epId, coreId, attempts);
+
+        failedMsgs[cmd.epId]++;
+        mc.failed++;
+    }
+
+    dtu.freeRequest(pkt);
+
+    assert(mc.pending > 0);
+    if (--mc.pending > 0)
+        return;
+
+    // the targets that did not receive the message give the credits back
+    if (mc.failed > 0)
+        giveCreditsBack(cmd.epId, mc.failed);
+
+    Dtu::Error error = mc.failed > 0 ? Dtu::Error::RECV_BUF_FULL : Dtu::Error::NONE;
+    mc.targets.clear();
+    dtu.scheduleFinishOp(cmd.slot, delay, error);
+}
+
+void
+MessageUnit::finishTransmission(const Dtu::Command& cmd, PacketPtr pkt)
+{
+    if (!multicasts[cmd.slot].targets.empty())
+    {
+        finishMulticast(cmd, pkt);
+        return;
+    }
+
+    RetryState &retry = retries[cmd.slot];
+
+    // we don't need to pay the payload delay here because the message basically has no payload
+    // since we only receive an ACK back for writing
+    Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
+
+    if (!pkt->isError())
+    {
+        dtu.scheduleFinishOp(cmd.slot, delay);
+        dtu.freeRequest(pkt);
+        return;
+    }
+
+    // the receiver rejected the message, because its buffer was full
+    if (retry.attempts < maxRetries)
+    {
+        retry.attempts++;
+        retriedMsgs[cmd.epId]++;
+
+        // resend the same data; the new packet takes over the reference to the payload
+        auto dpkt = static_cast<Dtu::DtuPacket*>(pkt);
+        retry.pkt = dtu.generateRequest(pkt->getAddr(),
+                                        pkt->getSize(),
+                                        MemCmd::WriteReq,
+                                        pkt->getPtr<uint8_t>(),
+                                        dpkt->payload);
+
+        // back off exponentially to give the receiver time to drain its buffer
+        delay += Cycles(retryDelay << (retry.attempts - 1));
+
+        DPRINTFS(DtuBuf, (&dtu), "EP%u: message rejected; retry %u of %u in %lu cycles\n",
+                 cmd.epId, retry.attempts, maxRetries, static_cast<uint64_t>(delay));
+
+        dtu.schedule(retry.event, dtu.clockEdge(delay));
+    }
+    else
+    {
+        DPRINTFS(DtuBuf, (&dtu), "EP%u: message rejected; giving up after %u retries\n",
+                 cmd.epId, retry.attempts);
+
+        failedMsgs[cmd.epId]++;
+
+        // the message has not been received, so we get the credits back. if it was a reply, the
+        // credits belong to the receiver, which would otherwise lose them for good.
+        if (cmd.opcode == Dtu::CommandOpcode::SEND)
+            giveCreditsBack(cmd.epId, 1);
+        else
+            sendCredits(cmd, pkt);
+
+        dtu.scheduleFinishOp(cmd.slot, delay, Dtu::Error::RECV_BUF_FULL);
+    }
+
+    dtu.freeRequest(pkt);
+}
+
+void
+MessageUnit::resendMessage(unsigned cmdSlot)
+{
+    RetryState &retry = retries[cmdSlot];
+
+    assert(retry.pkt != NULL);
+
+    dtu.sendNocRequest(Dtu::NocPacketType::MESSAGE,
+                       retry.pkt,
+                       Cycles(0),
+                       false,
+                       cmdSlot);
+
+    retry.pkt = NULL;
+}
+
+void
+MessageUnit::sendCredits(const Dtu::Command& cmd, PacketPtr pkt)
+{
+    // send just the header of the reply; the receiver grants the credits without storing it
+    auto cpkt = dtu.generateRequest(pkt->getAddr(),
+                                    sizeof(Dtu::MessageHeader),
+                                    MemCmd::WriteReq);
+
+    auto header = cpkt->getPtr<Dtu::MessageHeader>();
+    memcpy(header, pkt->getConstPtr<Dtu::MessageHeader>(), sizeof(*header));
+    header->flags |= Dtu::CREDITS_ONLY;
+    header->length = 0;
+
+    DPRINTFS(DtuCredits, (&dtu), "EP%u: sending the credits of the failed reply to %u:%u\n",
+             cmd.epId, NocAddr(pkt->getAddr()).coreId, header->replyEpId);
+
+    dtu.sendNocRequest(Dtu::NocPacketType::CREDITS,
+                       cpkt,
+                       Cycles(1),
+                       false,
+                       cmd.slot);
+}
+
+void
+MessageUnit::receiveCredits(const Dtu::MessageHeader& header)
+{
+    // Note that replyEpId is the Id of *our* sending EP
+    if (header.flags & Dtu::REPLY_FLAG &&
+        header.flags & Dtu::GRANT_CREDITS_FLAG &&
+        header.replyEpId < dtu.numEndpoints)
+    {
+        unsigned maxMessageSize = dtu.regs().get(header.replyEpId, EpReg::MAX_MSG_SIZE);
+        unsigned credits = dtu.regs().get(header.replyEpId, EpReg::CREDITS);
+        credits += maxMessageSize;
+
+        DPRINTFS(DtuCredits, (&dtu), "EP%u: received %u credits (%u in total)\n",
+                 header.replyEpId, maxMessageSize, credits);
+
+        updateCredits(header.replyEpId, credits);
+
+        if (creditStallStart[header.replyEpId] != MaxTick)
+        {
+            Tick stalled = curTick() - creditStallStart[header.replyEpId];
+            creditStallCycles[header.replyEpId] += dtu.ticksToCycles(stalled);
+            creditStallStart[header.replyEpId] = MaxTick;
+        }
+    }
+}
+
+void
+MessageUnit::recvCreditsFromNoc(PacketPtr pkt)
+{
+    assert(pkt->isWrite());
+    assert(pkt->getSize() == sizeof(Dtu::MessageHeader));
+
+    const Dtu::MessageHeader* header = pkt->getConstPtr<Dtu::MessageHeader>();
+    assert(header->flags & Dtu::CREDITS_ONLY);
+
+    DPRINTFS(Dtu, (&dtu), "\e[1m[cr <- %u]\e[0m credits for EP%u of undelivered reply\n",
+        header->senderCoreId, header->replyEpId);
+
+    receiveCredits(*header);
+
+    pkt->makeResponse();
+
+    if (!dtu.atomicMode)
+    {
+        Cycles delay = dtu.ticksToCycles(pkt->headerDelay + pkt->payloadDelay);
+        delay += dtu.nocToTransferLatency;
+
+        pkt->headerDelay = 0;
+        pkt->payloadDelay = 0;
+
+        dtu.schedNocRequestFinished(dtu.clockEdge(Cycles(1)));
+        dtu.schedNocResponse(pkt, dtu.clockEdge(delay));
+    }
+}
+
 void
-MessageUnit::incrementReadPtr(unsigned epId)
+MessageUnit::giveCreditsBack(unsigned epId, unsigned msgs)
+{
+    unsigned maxMessageSize = dtu.regs().get(epId, EpReg::MAX_MSG_SIZE);
+    unsigned credits = dtu.regs().get(epId, EpReg::CREDITS);
+    credits += maxMessageSize * msgs;
+
+    DPRINTFS(DtuCredits, (&dtu), "EP%u gets %u credits back (%u in total)\n",
+             epId, maxMessageSize * msgs, credits);
+
+    updateCredits(epId, credits);
+}
+
+void
+MessageUnit::updateCredits(unsigned epId, unsigned credits)
+{
+    dtu.regs().set(epId, EpReg::CREDITS, credits);
+
+    if (dtu.trace)
+    {
+        auto &rec = dtu.trace->add(DtuTrace::Event::CREDITS);
+        rec.epId = epId;
+        rec.size = credits;
+    }
+}
+
+void
+MessageUnit::incrementReadPtr(unsigned epId, unsigned count)
 {
     Addr readPtr    = dtu.regs().get(epId, EpReg::BUF_RD_PTR);
     Addr bufferAddr = dtu.regs().get(epId, EpReg::BUF_ADDR);
     Addr bufferSize = dtu.regs().get(epId, EpReg::BUF_SIZE);
     Addr messageCount = dtu.regs().get(epId, EpReg::BUF_MSG_CNT);
+    Addr fetchCount = dtu.regs().get(epId, EpReg::BUF_FETCH_CNT);
     unsigned maxMessageSize = dtu.regs().get(epId, EpReg::BUF_MSG_SIZE);
 
-    readPtr += maxMessageSize;
+    // TODO error handling
+    assert(count != 0 && messageCount >= count);
 
-    if (readPtr >= bufferAddr + bufferSize * maxMessageSize)
-        readPtr = bufferAddr;
+    Addr slot = (readPtr - bufferAddr) / maxMessageSize;
+    readPtr = bufferAddr + ((slot + count) % bufferSize) * maxMessageSize;
 
-    DPRINTFS(DtuBuf, (&dtu), "EP%u: increment read pointer to %#018lx (msgCount=%u)\n",
+    DPRINTFS(DtuBuf, (&dtu), "EP%u: increment read pointer by %u to %#018lx (msgCount=%u)\n",
              epId,
+             count,
              readPtr,
-             messageCount - 1);
-
-    // TODO error handling
-    assert(messageCount != 0);
+             messageCount - count);
 
     /*
      * XXX Actually an additianally cycle is needed to update the register.
@@ -243,7 +694,9 @@ MessageUnit::incrementReadPtr(unsigned epId)
      */
 
     dtu.regs().set(epId, EpReg::BUF_RD_PTR, readPtr);
-    dtu.regs().set(epId, EpReg::BUF_MSG_CNT, messageCount - 1);
+    dtu.regs().set(epId, EpReg::BUF_MSG_CNT, messageCount - count);
+    // the acknowledged messages are no longer fetched
+    dtu.regs().set(epId, EpReg::BUF_FETCH_CNT, fetchCount > count ? fetchCount - count : 0);
 
     dtu.updateSuspendablePin();
 }
@@ -276,8 +729,8 @@ MessageUnit::incrementWritePtr(unsigned epId)
     dtu.regs().set(epId, EpReg::BUF_WR_PTR, writePtr);
     dtu.regs().set(epId, EpReg::BUF_MSG_CNT, messageCount + 1);
 
+    // the core is notified as soon as the message has been written to memory (see XferUnit)
     dtu.updateSuspendablePin();
-    dtu.wakeupCore();
     return true;
 }
 
@@ -311,22 +764,12 @@ MessageUnit::recvFromNoc(PacketPtr pkt)
 
     if(messageCount < bufferSize)
     {
-        Dtu::MessageHeader* header = pkt->getPtr<Dtu::MessageHeader>();
+        receiveCredits(*pkt->getConstPtr<Dtu::MessageHeader>());
 
-        // Note that replyEpId is the Id of *our* sending EP
-        if (header->flags & Dtu::REPLY_FLAG &&
-            header->flags & Dtu::GRANT_CREDITS_FLAG &&
-            header->replyEpId < dtu.numEndpoints)
-        {
-            unsigned maxMessageSize = dtu.regs().get(header->replyEpId, EpReg::MAX_MSG_SIZE);
-            unsigned credits = dtu.regs().get(header->replyEpId, EpReg::CREDITS);
-            credits += maxMessageSize;
-
-            DPRINTFS(DtuCredits, (&dtu), "EP%u: received %u credits (%u in total)\n",
-                     header->replyEpId, maxMessageSize, credits);
-
-            dtu.regs().set(header->replyEpId, EpReg::CREDITS, credits);
-        }
+        auto senderState = dynamic_cast<Dtu::NocSenderState*>(pkt->senderState);
+        msgLatency.sample(dtu.ticksToCycles(curTick() + pkt->headerDelay - senderState->startTick));
+        receivedMsgs[epId]++;
+        receivedBytes[epId] += pkt->getSize();
 
         // the message is transferred piece by piece; we can start as soon as we have the header
         Cycles delay = dtu.ticksToCycles(pkt->headerDelay);
@@ -343,10 +786,15 @@ MessageUnit::recvFromNoc(PacketPtr pkt)
 
         incrementWritePtr(epId);
     }
-    // ignore messages if there is not enough space
+    // reject messages if there is not enough space; the sender will retry them
     else
     {
+        DPRINTFS(DtuBuf, (&dtu), "EP%u: rejecting message, because the buffer is full\n", epId);
+
+        rejectedMsgs[epId]++;
+
         pkt->makeResponse();
+        pkt->setBadAddress();
 
         if (!dtu.atomicMode)
         {
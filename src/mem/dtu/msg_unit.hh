@@ -31,12 +31,84 @@
 #ifndef __MEM_DTU_MSG_UNIT_HH__
 #define __MEM_DTU_MSG_UNIT_HH__
 
+#include "base/statistics.hh"
 #include "mem/dtu/dtu.hh"
 
 class MessageUnit
 {
   private:
 
+    struct RetryEvent : public Event
+    {
+        MessageUnit& msgUnit;
+
+        unsigned cmdSlot;
+
+        RetryEvent(MessageUnit& _msgUnit, unsigned _cmdSlot)
+            : msgUnit(_msgUnit), cmdSlot(_cmdSlot)
+        {}
+
+        void process() override
+        {
+            msgUnit.resendMessage(cmdSlot);
+        }
+
+        const char* description() const override { return "RetryEvent"; }
+
+        const std::string name() const override { return msgUnit.name(); }
+    };
+
+    /**
+     * The state to resend a message that has been rejected by the receiver. The packet keeps a
+     * reference to the payload, so that we don't need to read the message again.
+     */
+    struct RetryState
+    {
+        unsigned attempts;
+        PacketPtr pkt;
+        RetryEvent *event;
+    };
+
+    /**
+     * A message to a group of cores, per command slot. The message is read from local memory once
+     * and a copy that shares the payload is sent to each target. The command is finished as soon
+     * as all targets have accepted the message or rejected it too often.
+     */
+    struct Multicast
+    {
+        // the target cores in ascending order (empty for messages to a single core)
+        std::vector<unsigned> targets;
+        // the number of retries per target
+        std::vector<unsigned> attempts;
+        // the number of copies that are still on their way
+        unsigned pending;
+        // the number of targets that did not accept the message
+        unsigned failed;
+    };
+
+    struct MulticastRetryEvent : public PooledEvent<MulticastRetryEvent>
+    {
+        MessageUnit& msgUnit;
+
+        PacketPtr pkt;
+
+        unsigned cmdSlot;
+
+        MulticastRetryEvent(MessageUnit& _msgUnit, PacketPtr _pkt, unsigned _cmdSlot)
+            : PooledEvent<MulticastRetryEvent>(Default_Pri, AutoDelete),
+              msgUnit(_msgUnit), pkt(_pkt), cmdSlot(_cmdSlot)
+        {}
+
+        void process() override
+        {
+            msgUnit.dtu.sendNocRequest(Dtu::NocPacketType::MESSAGE, pkt, Cycles(0), false, cmdSlot);
+        }
+
+        const char* description() const override { return "MulticastRetryEvent"; }
+
+        const std::string name() const override { return msgUnit.name(); }
+    };
+
     struct MsgInfo
     {
         bool ready;
@@ -47,9 +119,29 @@ class MessageUnit
         uint64_t replyLabel;
     };
 
+    struct ReplyHeader
+    {
+        Dtu::MessageHeader header;
+        Addr offset;
+        // the message we reply to; latched, because the read pointer might be moved meanwhile
+        Addr msgAddr;
+    };
+
   public:
 
-    MessageUnit(Dtu &_dtu) : dtu(_dtu), info(), header(), offset() {}
+    MessageUnit(Dtu &_dtu, unsigned cmdQueueSize, unsigned _maxRetries, Cycles _retryDelay);
+
+    ~MessageUnit();
+
+    const std::string name() const { return dtu.name() + ".msg"; }
+
+    void regStats();
+
+    /**
+     * True if no message waits to be resent. The multicast retries are bound to their command
+     * slot, which stays busy until all of them are done.
+     */
+    bool isIdle() const;
 
     /**
      * Start message transmission -> Mem request
@@ -61,32 +153,87 @@ class MessageUnit
      */
     void recvFromMem(const Dtu::Command& cmd, PacketPtr pkt);
 
+    /**
+     * Sends the message that has been read from local memory to its target(s)
+     */
+    void sendMessage(PacketPtr pkt, Cycles delay, unsigned cmdSlot);
+
+    /**
+     * Received the response for a message from the NoC (ACK or NACK)
+     */
+    void finishTransmission(const Dtu::Command& cmd, PacketPtr pkt);
+
     /**
      * Received a message from NoC -> Mem request
      */
     void recvFromNoc(PacketPtr pkt);
 
     /**
-     * Move read pointer forward
+     * Received the credits of a reply that could not be delivered from NoC
      */
-    void incrementReadPtr(unsigned epId);
+    void recvCreditsFromNoc(PacketPtr pkt);
+
+    /**
+     * Move read pointer forward by <count> messages
+     */
+    void incrementReadPtr(unsigned epId, unsigned count = 1);
 
   private:
 
     bool incrementWritePtr(unsigned epId);
 
-    void requestHeader(unsigned epid);
+    void requestHeader(const Dtu::Command& cmd);
+
+    void startXfer(const Dtu::Command& cmd, MsgInfo& info);
+
+    void resendMessage(unsigned cmdSlot);
+
+    void finishMulticast(const Dtu::Command& cmd, PacketPtr pkt);
+
+    /**
+     * Decodes the multicast targets in <tgtCoreId> (see Dtu::TargetFlags). Returns false if they
+     * are invalid.
+     */
+    bool getTargets(RegFile::reg_t tgtCoreId, std::vector<unsigned> &targets) const;
+
+    void giveCreditsBack(unsigned epId, unsigned msgs);
+
+    void sendCredits(const Dtu::Command& cmd, PacketPtr pkt);
 
-    void startXfer(const Dtu::Command& cmd);
+    void receiveCredits(const Dtu::MessageHeader& header);
+
+    void updateCredits(unsigned epId, unsigned credits);
 
   private:
 
     Dtu &dtu;
 
-    MsgInfo info;
+    const unsigned maxRetries;
+    const Cycles retryDelay;
+
+    // the header of the message we reply to, per command slot
+    std::vector<ReplyHeader> replyHeaders;
+
+    // the retry state of the message that is sent, per command slot
+    std::vector<RetryState> retries;
+
+    // the targets of the message that is sent, per command slot
+    std::vector<Multicast> multicasts;
+
+    // since when each endpoint lacks credits (MaxTick if it does not)
+    std::vector<Tick> creditStallStart;
 
-    Dtu::MessageHeader header;
-    Addr offset;
+    Stats::Vector sentMsgs;
+    Stats::Vector sentBytes;
+    Stats::Vector multicastMsgs;
+    Stats::Vector receivedMsgs;
+    Stats::Vector receivedBytes;
+    Stats::Histogram msgLatency;
+    Stats::Vector creditStalls;
+    Stats::Vector creditStallCycles;
+    Stats::Vector rejectedMsgs;
+    Stats::Vector retriedMsgs;
+    Stats::Vector failedMsgs;
 };
 
 #endif
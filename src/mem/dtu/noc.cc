@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include "base/intmath.hh"
+#include "debug/DtuNoc.hh"
+#include "mem/dtu/dtu.hh"
+#include "mem/dtu/noc.hh"
+#include "mem/dtu/noc_addr.hh"
+
+DtuNoc::DtuNoc(const DtuNocParams *p)
+    : NoncoherentXBar(p),
+      topology(p->topology),
+      cols(p->cols),
+      rows(p->rows),
+      linkWidth(p->link_width),
+      routerLatency(p->router_latency),
+      linkLatency(p->link_latency),
+      links(p->cols * p->rows * DIRECTIONS, 0),
+      reqRetryEvents(),
+      respRetryEvents()
+{
+    fatal_if(cols == 0 || rows == 0, "The NoC needs at least one row and one column");
+    fatal_if(linkWidth == 0, "The link width has to be non-zero");
+
+    for (size_t i = 0; i < slavePorts.size(); ++i)
+        reqRetryEvents.push_back(new LinkRetryEvent(*this, i, false));
+    for (size_t i = 0; i < masterPorts.size(); ++i)
+        respRetryEvents.push_back(new LinkRetryEvent(*this, i, true));
+}
+
+DtuNoc::~DtuNoc()
+{
+    for (auto ev : reqRetryEvents)
+        delete ev;
+    for (auto ev : respRetryEvents)
+        delete ev;
+}
+
+void
+DtuNoc::LinkRetryEvent::process()
+{
+    if (resp)
+        noc.masterPorts[id]->sendRetryResp();
+    else
+        noc.slavePorts[id]->sendRetryReq();
+}
+
+void
+DtuNoc::regStats()
+{
+    NoncoherentXBar::regStats();
+
+    hops
+        .init(cols + rows)
+        .name(name() + ".hops")
+        .desc("Number of links a packet traversed")
+        .flags(Stats::nozero);
+    linkWaitTime
+        .init(16)
+        .name(name() + ".linkWaitTime")
+        .desc("Cycles a packet was held back at its sender because of busy links")
+        .flags(Stats::nozero);
+    delayedPackets
+        .name(name() + ".delayedPackets")
+        .desc("Number of packets that were refused at least once because of a busy link");
+}
+
+unsigned
+DtuNoc::srcCoreOf(PacketPtr pkt) const
+{
+    // the DTU puts its sender state on top of the stack before sending the packet to us
+    auto senderState = dynamic_cast<Dtu::NocSenderState*>(pkt->senderState);
+    if (!senderState)
+        return INVALID_CORE;
+    return senderState->srcCoreId;
+}
+
+unsigned
+DtuNoc::dstCoreOf(PacketPtr pkt) const
+{
+    return NocAddr(pkt->getAddr()).coreId;
+}
+
+unsigned
+DtuNoc::hopCount(unsigned src, unsigned dst) const
+{
+    unsigned dx = src % cols > dst % cols ? src % cols - dst % cols : dst % cols - src % cols;
+    unsigned dy = src / cols > dst / cols ? src / cols - dst / cols : dst / cols - src / cols;
+    if (topology == Enums::torus)
+    {
+        dx = std::min(dx, cols - dx);
+        dy = std::min(dy, rows - dy);
+    }
+    return dx + dy;
+}
+
+DtuNoc::Direction
+DtuNoc::nextDir(unsigned pos, unsigned dst, unsigned size, bool horizontal) const
+{
+    if (pos == dst)
+        return DIRECTIONS;
+
+    bool forward = dst > pos;
+    // in a torus, take the wrap-around link if that is shorter
+    if (topology == Enums::torus)
+        forward = (dst + size - pos) % size <= size / 2;
+
+    if (horizontal)
+        return forward ? EAST : WEST;
+    return forward ? SOUTH : NORTH;
+}
+
+Tick
+DtuNoc::traverse(unsigned src, unsigned dst, unsigned bytes, Tick now, bool reserve,
+                 Tick &waited)
+{
+    // the header flit and the payload flits occupy each link one after another
+    Tick occupancy = (1 + divCeil(bytes, linkWidth)) * clockPeriod();
+    waited = 0;
+
+    unsigned x = src % cols;
+    unsigned y = src / cols;
+    Tick time = now;
+    while (true)
+    {
+        Direction dir = nextDir(x, dst % cols, cols, true);
+        if (dir == DIRECTIONS)
+            dir = nextDir(y, dst / cols, rows, false);
+
+        // the router of the current position needs to process the header
+        time += routerLatency * clockPeriod();
+        if (dir == DIRECTIONS)
+            break;
+
+        Tick &busy = linkBusy(y * cols + x, dir);
+        if (busy > time)
+        {
+            waited += busy - time;
+            time = busy;
+        }
+        if (reserve)
+            busy = time + occupancy;
+        time += linkLatency * clockPeriod();
+
+        switch (dir)
+        {
+            case EAST:
+                x = (x + 1) % cols;
+                break;
+            case WEST:
+                x = (x + cols - 1) % cols;
+                break;
+            case SOUTH:
+                y = (y + 1) % rows;
+                break;
+            default:
+                y = (y + rows - 1) % rows;
+                break;
+        }
+    }
+
+    if (reserve)
+        hops.sample(hopCount(src, dst));
+
+    return time;
+}
+
+Tick
+DtuNoc::addMeshDelay(PacketPtr pkt, unsigned src, unsigned dst, Tick &waited)
+{
+    waited = 0;
+    if (src == INVALID_CORE)
+        return 0;
+
+    panic_if(src >= cols * rows || dst >= cols * rows,
+             "Packet from core %u to core %u leaves the %ux%u NoC\n", src, dst, cols, rows);
+
+    unsigned bytes = pkt->hasData() ? pkt->getSize() : 0;
+    Tick delay = traverse(src, dst, bytes, clockEdge(), false, waited) - clockEdge();
+    pkt->headerDelay += delay;
+    return delay;
+}
+
+void
+DtuNoc::refuse(LinkRetryEvent *ev, Tick waited)
+{
+    DPRINTF(DtuNoc, "Refusing packet from %s port %d for %llu ticks; link busy\n",
+            ev->resp ? "master" : "slave", ev->id, waited);
+
+    if (ev->refusedSince == MaxTick)
+        ev->refusedSince = curTick();
+
+    // the port waits for our retry, so that there can only be one refused packet per port
+    assert(!ev->scheduled());
+    schedule(ev, clockEdge(ticksToCycles(waited)));
+}
+
+void
+DtuNoc::accepted(LinkRetryEvent *ev)
+{
+    if (ev->refusedSince != MaxTick)
+    {
+        delayedPackets++;
+        linkWaitTime.sample(ticksToCycles(curTick() - ev->refusedSince));
+        ev->refusedSince = MaxTick;
+    }
+}
+
+void
+DtuNoc::occupyLinks(PacketPtr pkt, unsigned src, unsigned dst)
+{
+    if (src == INVALID_CORE)
+        return;
+
+    unsigned bytes = pkt->hasData() ? pkt->getSize() : 0;
+    Tick waited;
+    Tick delay = traverse(src, dst, bytes, clockEdge(), true, waited) - clockEdge();
+    // we only accept packets that do not need to wait
+    assert(waited == 0);
+
+    DPRINTF(DtuNoc, "%s %s 0x%x: core %u -> core %u, %u hops, %llu ticks\n",
+            pkt->isResponse() ? "Resp" : "Req", pkt->cmdString(), pkt->getAddr(),
+            src, dst, hopCount(src, dst), delay);
+}
+
+bool
+DtuNoc::recvTimingReq(PacketPtr pkt, PortID slave_port_id)
+{
+    unsigned src = srcCoreOf(pkt);
+    unsigned dst = dstCoreOf(pkt);
+
+    // only occupy the links if the crossbar accepts the packet; the time does not advance meanwhile
+    Tick waited;
+    Tick delay = addMeshDelay(pkt, src, dst, waited);
+
+    if (waited > 0)
+    {
+        pkt->headerDelay -= delay;
+        refuse(reqRetryEvents[slave_port_id], waited);
+        return false;
+    }
+
+    if (!NoncoherentXBar::recvTimingReq(pkt, slave_port_id))
+    {
+        pkt->headerDelay -= delay;
+        return false;
+    }
+
+    accepted(reqRetryEvents[slave_port_id]);
+    occupyLinks(pkt, src, dst);
+    return true;
+}
+
+bool
+DtuNoc::recvTimingResp(PacketPtr pkt, PortID master_port_id)
+{
+    // the response travels back from the addressed core to the requester
+    unsigned dst = srcCoreOf(pkt);
+    unsigned src = dst == INVALID_CORE ? INVALID_CORE : dstCoreOf(pkt);
+
+    Tick waited;
+    Tick delay = addMeshDelay(pkt, src, dst, waited);
+
+    if (waited > 0)
+    {
+        pkt->headerDelay -= delay;
+        refuse(respRetryEvents[master_port_id], waited);
+        return false;
+    }
+
+    if (!NoncoherentXBar::recvTimingResp(pkt, master_port_id))
+    {
+        pkt->headerDelay -= delay;
+        return false;
+    }
+
+    accepted(respRetryEvents[master_port_id]);
+    occupyLinks(pkt, src, dst);
+    return true;
+}
+
+Tick
+DtuNoc::recvAtomic(PacketPtr pkt, PortID slave_port_id)
+{
+    unsigned src = srcCoreOf(pkt);
+    unsigned dst = dstCoreOf(pkt);
+
+    // there is no contention in atomic mode; just account for the distance in both directions
+    Tick waited;
+    Tick delay = addMeshDelay(pkt, src, dst, waited);
+
+    Tick latency = NoncoherentXBar::recvAtomic(pkt, slave_port_id);
+
+    if (pkt->isResponse())
+        delay += addMeshDelay(pkt, src == INVALID_CORE ? INVALID_CORE : dst, src, waited);
+
+    return latency + delay;
+}
+
+DtuNoc*
+DtuNocParams::create()
+{
+    return new DtuNoc(this);
+}
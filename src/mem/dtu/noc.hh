@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __MEM_DTU_NOC_HH__
+#define __MEM_DTU_NOC_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "enums/NocTopology.hh"
+#include "mem/noncoherent_xbar.hh"
+#include "params/DtuNoc.hh"
+
+/**
+ * A NoC for DTUs that arranges the PEs in a 2D mesh or torus. Each PE is attached to one router,
+ * whereas PE <coreId> sits at (coreId % cols, coreId / cols). Packets are routed in XY order and
+ * each traversed link can only transmit one packet at a time. A packet that would have to wait for
+ * a busy link is refused and its sender gets a retry as soon as the link is free again. Thus,
+ * contention is pushed back to the senders instead of accumulating in the header delay.
+ *
+ * The crossbar underneath is still responsible for the decoding and the flow control at the ports.
+ * Packets that have not been sent by a DTU (e.g., IO requests) only see the crossbar latency.
+ */
+class DtuNoc : public NoncoherentXBar
+{
+  public:
+
+    DtuNoc(const DtuNocParams *p);
+
+    ~DtuNoc();
+
+    void regStats() override;
+
+  protected:
+
+    bool recvTimingReq(PacketPtr pkt, PortID slave_port_id) override;
+
+    bool recvTimingResp(PacketPtr pkt, PortID master_port_id) override;
+
+    Tick recvAtomic(PacketPtr pkt, PortID slave_port_id) override;
+
+  private:
+
+    enum Direction
+    {
+        EAST,
+        WEST,
+        NORTH,
+        SOUTH,
+        DIRECTIONS,
+    };
+
+    static const unsigned INVALID_CORE = static_cast<unsigned>(-1);
+
+    /**
+     * Sends a retry to a port whose packet we refused because of a busy link
+     */
+    struct LinkRetryEvent : public Event
+    {
+        DtuNoc& noc;
+
+        PortID id;
+
+        // true if we refused a response (from a master port)
+        bool resp;
+
+        // the tick at which we refused the first packet since the last acceptance (or MaxTick)
+        Tick refusedSince;
+
+        LinkRetryEvent(DtuNoc& _noc, PortID _id, bool _resp)
+            : noc(_noc), id(_id), resp(_resp), refusedSince(MaxTick)
+        {}
+
+        void process() override;
+
+        const char* description() const override { return "DtuNoc LinkRetryEvent"; }
+
+        const std::string name() const override { return noc.name(); }
+    };
+
+    /**
+     * Determines the core of the DTU that sent the request <pkt> (or the request that <pkt> is the
+     * response for). Returns INVALID_CORE if it has not been sent by a DTU.
+     */
+    unsigned srcCoreOf(PacketPtr pkt) const;
+
+    /**
+     * Determines the core <pkt> is addressed to.
+     */
+    unsigned dstCoreOf(PacketPtr pkt) const;
+
+    unsigned hopCount(unsigned src, unsigned dst) const;
+
+    /**
+     * Determines the direction to go from <pos> to <dst> within one dimension of size <size>.
+     * Returns DIRECTIONS if <pos> == <dst>.
+     */
+    Direction nextDir(unsigned pos, unsigned dst, unsigned size, bool horizontal) const;
+
+    /**
+     * Routes a packet of <bytes> bytes from core <src> to core <dst>, starting at <now>.
+     * If <reserve> is true, the traversed links are occupied accordingly. <waited> receives the
+     * time the header had to wait for busy links on the way.
+     *
+     * @return the point in time the header arrives at the destination
+     */
+    Tick traverse(unsigned src, unsigned dst, unsigned bytes, Tick now, bool reserve,
+                  Tick &waited);
+
+    /**
+     * Adds the mesh delay to the header delay of the packet, if it goes from one PE to another.
+     * The links are not occupied yet. <waited> receives the time the packet would have to wait
+     * for busy links.
+     *
+     * @return the added delay
+     */
+    Tick addMeshDelay(PacketPtr pkt, unsigned src, unsigned dst, Tick &waited);
+
+    /**
+     * Refuses a packet because it would have to wait <waited> ticks for a busy link. The sender
+     * gets a retry via <ev> as soon as the link is free.
+     */
+    void refuse(LinkRetryEvent *ev, Tick waited);
+
+    /**
+     * Records that the packet of the port of <ev> has been accepted.
+     */
+    void accepted(LinkRetryEvent *ev);
+
+    /**
+     * Occupies the links on the way from <src> to <dst> for <pkt>, if it goes from one PE to
+     * another.
+     */
+    void occupyLinks(PacketPtr pkt, unsigned src, unsigned dst);
+
+    Tick& linkBusy(unsigned router, Direction dir)
+    {
+        return links[router * DIRECTIONS + dir];
+    }
+
+    const Enums::NocTopology topology;
+
+    const unsigned cols;
+    const unsigned rows;
+
+    const unsigned linkWidth;
+    const Cycles routerLatency;
+    const Cycles linkLatency;
+
+    // the point in time until which each (outgoing) link of each router is busy
+    std::vector<Tick> links;
+
+    // one per slave port (requests) and master port (responses)
+    std::vector<LinkRetryEvent*> reqRetryEvents;
+    std::vector<LinkRetryEvent*> respRetryEvents;
+
+    Stats::Histogram hops;
+    Stats::Histogram linkWaitTime;
+    Stats::Scalar delayedPackets;
+};
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include "base/trace.hh"
+#include "debug/Drain.hh"
+#include "debug/DtuNoc.hh"
+#include "mem/dtu/noc_link.hh"
+
+NocLink::NocLink(const NocLinkParams *p)
+    : MemObject(p),
+      nocEm(getEventQueue(p->noc_eventq_index)),
+      latency(p->latency),
+      inFlight(0),
+      peSlavePort(name() + ".pe_slave", *this, *this),
+      peMasterPort(name() + ".pe_master", *this, *this),
+      nocMasterPort(name() + ".noc_master", *this, nocEm),
+      nocSlavePort(name() + ".noc_slave", *this, nocEm)
+{
+}
+
+void
+NocLink::init()
+{
+    MemObject::init();
+
+    if (peSlavePort.isConnected())
+        peSlavePort.sendRangeChange();
+    if (nocSlavePort.isConnected())
+        nocSlavePort.sendRangeChange();
+}
+
+void
+NocLink::startup()
+{
+    MemObject::startup();
+
+    fatal_if(eventQueue() != nocEm.eventQueue() && latency < simQuantum,
+             "%s: the latency (%llu) needs to be at least the simulation quantum (%llu)\n",
+             name(), latency, simQuantum);
+}
+
+DrainState
+NocLink::drain()
+{
+    // the simulation threads are stopped while draining, so that inFlight cannot change meanwhile
+    if (inFlight > 0)
+    {
+        DPRINTF(Drain, "%s: %u packets in flight\n", name(), inFlight.load());
+        return DrainState::Draining;
+    }
+    return DrainState::Drained;
+}
+
+BaseMasterPort&
+NocLink::getMasterPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "pe_master")
+        return peMasterPort;
+    else if (if_name == "noc_master")
+        return nocMasterPort;
+    else
+        return MemObject::getMasterPort(if_name, idx);
+}
+
+BaseSlavePort&
+NocLink::getSlavePort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "pe_slave")
+        return peSlavePort;
+    else if (if_name == "noc_slave")
+        return nocSlavePort;
+    else
+        return MemObject::getSlavePort(if_name, idx);
+}
+
+void
+NocLink::transfer(PacketPtr pkt, const Port &from)
+{
+    auto ev = new TransferEvent(*this, pkt);
+
+    // requests go from slave to master port and responses the other way around
+    EventQueue *queue;
+    if (&from == &peSlavePort)
+    {
+        ev->masterPort = &nocMasterPort;
+        queue = nocEm.eventQueue();
+    }
+    else if (&from == &nocSlavePort)
+    {
+        ev->masterPort = &peMasterPort;
+        queue = eventQueue();
+    }
+    else if (&from == &peMasterPort)
+    {
+        ev->slavePort = &nocSlavePort;
+        queue = nocEm.eventQueue();
+    }
+    else
+    {
+        ev->slavePort = &peSlavePort;
+        queue = eventQueue();
+    }
+
+    DPRINTF(DtuNoc, "%s: %s %s 0x%x arrives at %llu\n",
+            from.name(), pkt->isResponse() ? "Resp" : "Req", pkt->cmdString(),
+            pkt->getAddr(), curTick() + latency);
+
+    inFlight++;
+
+    // this uses asyncInsert if the queue belongs to a different thread
+    queue->schedule(ev, curTick() + latency);
+}
+
+void
+NocLink::TransferEvent::process()
+{
+    // the header and payload delay are still paid by the receiver
+    if (masterPort)
+        masterPort->schedTimingReq(pkt, curTick());
+    else
+        slavePort->schedTimingResp(pkt, curTick());
+
+    // the packet is in the port queue now, which drains on its own
+    if (--link.inFlight == 0 && link.drainState() == DrainState::Draining)
+        link.signalDrainDone();
+}
+
+bool
+NocLink::LinkMasterPort::recvTimingResp(PacketPtr pkt)
+{
+    link.transfer(pkt, *this);
+    return true;
+}
+
+void
+NocLink::LinkMasterPort::recvRangeChange()
+{
+    LinkSlavePort &other = this == &link.peMasterPort ? link.nocSlavePort : link.peSlavePort;
+    if (other.isConnected())
+        other.sendRangeChange();
+}
+
+bool
+NocLink::LinkSlavePort::recvTimingReq(PacketPtr pkt)
+{
+    link.transfer(pkt, *this);
+    return true;
+}
+
+Tick
+NocLink::LinkSlavePort::recvAtomic(PacketPtr pkt)
+{
+    // we would call into the other thread without synchronization
+    fatal_if(link.eventQueue() != link.nocEm.eventQueue(),
+             "%s: atomic accesses are not supported if the PE and the NoC run in parallel\n",
+             name());
+
+    LinkMasterPort &other = this == &link.peSlavePort ? link.nocMasterPort : link.peMasterPort;
+    return other.sendAtomic(pkt) + link.latency;
+}
+
+void
+NocLink::LinkSlavePort::recvFunctional(PacketPtr pkt)
+{
+    // as for atomic accesses, we would touch the other side from the wrong thread
+    fatal_if(link.eventQueue() != link.nocEm.eventQueue(),
+             "%s: functional accesses are not supported if the PE and the NoC run in parallel\n",
+             name());
+
+    // the packet might still be on its way
+    if (respQueue.checkFunctional(pkt))
+        return;
+
+    LinkMasterPort &other = this == &link.peSlavePort ? link.nocMasterPort : link.peMasterPort;
+    other.sendFunctional(pkt);
+}
+
+AddrRangeList
+NocLink::LinkSlavePort::getAddrRanges() const
+{
+    const LinkMasterPort &other = this == &link.peSlavePort ? link.nocMasterPort : link.peMasterPort;
+    return other.getAddrRanges();
+}
+
+NocLink*
+NocLinkParams::create()
+{
+    return new NocLink(this);
+}
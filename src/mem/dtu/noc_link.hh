@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __MEM_DTU_NOC_LINK_HH__
+#define __MEM_DTU_NOC_LINK_HH__
+
+#include <atomic>
+
+#include "mem/mem_object.hh"
+#include "mem/qport.hh"
+#include "params/NocLink.hh"
+
+/**
+ * Connects the NoC ports of a PE to the NoC, whereas the PE and the NoC may belong to different
+ * event queues and are thus simulated by different host threads. The link lives in the event
+ * queue of the PE, while the NoC side uses the event queue <noc_eventq_index>.
+ *
+ * Packets are never handed to the other side by a direct call, but by scheduling an event in the
+ * event queue of the other side, <latency> ticks in the future (which uses asyncInsert in parallel
+ * mode). As the latency is at least the simulation quantum, the other side cannot have passed
+ * this point in time yet. The link accepts all packets and buffers them until the receiver
+ * accepts them.
+ *
+ * Atomic and functional accesses are forwarded directly and are therefore only supported if the
+ * simulation does not run in parallel.
+ *
+ * The link is drained as soon as no packet is on its way to the other side anymore. The packets
+ * waiting in the port queues are drained by the queues themselves.
+ */
+class NocLink : public MemObject
+{
+  private:
+
+    class LinkMasterPort : public QueuedMasterPort
+    {
+      public:
+
+        LinkMasterPort(const std::string& _name, NocLink& _link, EventManager& em)
+          : QueuedMasterPort(_name, &_link, reqQueue, snoopRespQueue),
+            link(_link),
+            reqQueue(em, *this),
+            snoopRespQueue(em, *this)
+        { }
+
+      protected:
+
+        bool recvTimingResp(PacketPtr pkt) override;
+
+        void recvRangeChange() override;
+
+      private:
+
+        NocLink& link;
+
+        ReqPacketQueue reqQueue;
+
+        SnoopRespPacketQueue snoopRespQueue;
+    };
+
+    class LinkSlavePort : public QueuedSlavePort
+    {
+      public:
+
+        LinkSlavePort(const std::string& _name, NocLink& _link, EventManager& em)
+          : QueuedSlavePort(_name, &_link, respQueue),
+            link(_link),
+            respQueue(em, *this)
+        { }
+
+      protected:
+
+        bool recvTimingReq(PacketPtr pkt) override;
+
+        Tick recvAtomic(PacketPtr pkt) override;
+
+        void recvFunctional(PacketPtr pkt) override;
+
+        AddrRangeList getAddrRanges() const override;
+
+      private:
+
+        NocLink& link;
+
+        RespPacketQueue respQueue;
+    };
+
+    struct TransferEvent : public PooledEvent<TransferEvent>
+    {
+        NocLink& link;
+
+        PacketPtr pkt;
+
+        // the port that sends the packet on the other side
+        LinkMasterPort *masterPort;
+        LinkSlavePort *slavePort;
+
+        TransferEvent(NocLink& _link, PacketPtr _pkt)
+            : PooledEvent<TransferEvent>(Default_Pri, AutoDelete),
+              link(_link),
+              pkt(_pkt),
+              masterPort(),
+              slavePort()
+        {}
+
+        void process() override;
+
+        const char* description() const override { return "NocLink TransferEvent"; }
+
+        const std::string name() const override { return link.name(); }
+    };
+
+  public:
+
+    NocLink(const NocLinkParams *p);
+
+    void init() override;
+
+    void startup() override;
+
+    DrainState drain() override;
+
+    BaseMasterPort& getMasterPort(const std::string &if_name, PortID idx) override;
+
+    BaseSlavePort& getSlavePort(const std::string &if_name, PortID idx) override;
+
+  private:
+
+    /**
+     * Hands <pkt>, which has been received by <from>, over to the opposite side of the link
+     */
+    void transfer(PacketPtr pkt, const Port &from);
+
+    // the event manager for the NoC side
+    EventManager nocEm;
+
+    const Tick latency;
+
+    // the number of scheduled TransferEvents; changed by the threads of both sides
+    std::atomic<unsigned> inFlight;
+
+    LinkSlavePort peSlavePort;
+    LinkMasterPort peMasterPort;
+
+    LinkMasterPort nocMasterPort;
+    LinkSlavePort nocSlavePort;
+};
+
+#endif
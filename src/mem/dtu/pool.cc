@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include "base/intmath.hh"
+#include "mem/dtu/pool.hh"
+
+static const size_t MIN_CLASS_ORDER = 3;
+
+PayloadPool::PayloadPool(bool _enabled)
+    : enabled(_enabled), freeLists()
+{
+}
+
+PayloadPool::~PayloadPool()
+{
+    for (auto &list : freeLists)
+    {
+        for (auto payload : list)
+        {
+            delete[] payload->data;
+            delete payload;
+        }
+    }
+}
+
+size_t
+PayloadPool::sizeClass(size_t size)
+{
+    size_t order = size > 1 ? ceilLog2(size) : 0;
+    return order < MIN_CLASS_ORDER ? 0 : order - MIN_CLASS_ORDER;
+}
+
+Payload*
+PayloadPool::alloc(size_t size)
+{
+    size_t cls = sizeClass(size);
+
+    Payload *payload;
+    if (cls < freeLists.size() && !freeLists[cls].empty())
+    {
+        payload = freeLists[cls].back();
+        freeLists[cls].pop_back();
+    }
+    else
+    {
+        payload = new Payload;
+        payload->data = new uint8_t[static_cast<size_t>(1) << (cls + MIN_CLASS_ORDER)];
+        payload->sizeClass = cls;
+    }
+
+    payload->refs = 1;
+    return payload;
+}
+
+void
+PayloadPool::unref(Payload *payload)
+{
+    assert(payload->refs > 0);
+    if (--payload->refs > 0)
+        return;
+
+    if (!enabled)
+    {
+        delete[] payload->data;
+        delete payload;
+        return;
+    }
+
+    size_t cls = payload->sizeClass;
+    if (cls >= freeLists.size())
+        freeLists.resize(cls + 1);
+    freeLists[cls].push_back(payload);
+}
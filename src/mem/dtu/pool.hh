@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#ifndef __MEM_DTU_POOL_HH__
+#define __MEM_DTU_POOL_HH__
+
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "base/types.hh"
+
+/**
+ * A free-list of objects of type T. Objects are constructed in place in previously released
+ * memory, so that the allocator is only involved until the pool has reached its working set.
+ * If disabled, it simply uses new and delete.
+ */
+template<class T>
+class ObjectPool
+{
+  public:
+
+    explicit ObjectPool(bool _enabled)
+        : enabled(_enabled), freeList()
+    {}
+
+    ~ObjectPool()
+    {
+        for (auto obj : freeList)
+            ::operator delete(obj);
+    }
+
+    template<typename... Args>
+    T *create(Args&&... args)
+    {
+        void *mem;
+        if (freeList.empty())
+            mem = ::operator new(sizeof(T));
+        else
+        {
+            mem = freeList.back();
+            freeList.pop_back();
+        }
+
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *obj)
+    {
+        obj->~T();
+
+        if (enabled)
+            freeList.push_back(obj);
+        else
+            ::operator delete(obj);
+    }
+
+  private:
+
+    const bool enabled;
+
+    std::vector<void*> freeList;
+};
+
+/**
+ * A reference-counted packet payload. It allows multiple packets to point to the same data via
+ * Packet::dataStatic (e.g., a transfer buffer and the NoC packet that is sent from it).
+ */
+struct Payload
+{
+    uint8_t *data;
+    size_t sizeClass;
+    unsigned refs;
+};
+
+/**
+ * A pool for packet payloads, which keeps a free-list for each power-of-two size class.
+ */
+class PayloadPool
+{
+  public:
+
+    explicit PayloadPool(bool _enabled);
+
+    ~PayloadPool();
+
+    /**
+     * @return a new payload of at least <size> bytes with a reference count of 1
+     */
+    Payload *alloc(size_t size);
+
+    void ref(Payload *payload)
+    {
+        payload->refs++;
+    }
+
+    /**
+     * Drops a reference and releases the payload if it was the last one
+     */
+    void unref(Payload *payload);
+
+  private:
+
+    static size_t sizeClass(size_t size);
+
+    const bool enabled;
+
+    std::vector<std::vector<Payload*>> freeLists;
+};
+
+#endif
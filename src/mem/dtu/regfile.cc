@@ -36,6 +36,10 @@
 const char *RegFile::dtuRegNames[] = {
     "STATUS",
     "MSG_CNT",
+    "CMD_SLOT",
+    "CMD_BUSY",
+    "CMD_ERROR",
+    "IRQ_EN",
 };
 
 const char *RegFile::cmdRegNames[] = {
@@ -62,6 +66,8 @@ const char *RegFile::epRegNames[] = {
     "REQ_REM_ADDR",
     "REQ_REM_SIZE",
     "REQ_FLAGS",
+    "BUF_FETCH_MSG",
+    "BUF_FETCH_CNT",
 };
 
 RegFile::RegFile(const std::string& name, unsigned _numEndpoints)
@@ -157,6 +163,31 @@ RegFile::set(unsigned epid, EpReg reg, reg_t value)
     epRegs[epid][static_cast<Addr>(reg)] = value;
 }
 
+RegFile::reg_t
+RegFile::fetchMessage(unsigned epid)
+{
+    reg_t msgCount   = get(epid, EpReg::BUF_MSG_CNT);
+    reg_t fetchCount = get(epid, EpReg::BUF_FETCH_CNT);
+
+    if (fetchCount >= msgCount)
+        return 0;
+
+    reg_t bufAddr = get(epid, EpReg::BUF_ADDR);
+    reg_t bufSize = get(epid, EpReg::BUF_SIZE);
+    reg_t msgSize = get(epid, EpReg::BUF_MSG_SIZE);
+    reg_t readPtr = get(epid, EpReg::BUF_RD_PTR);
+
+    // the fetched messages are the ones behind the read pointer
+    reg_t slot = (readPtr - bufAddr) / msgSize;
+    reg_t msgAddr = bufAddr + ((slot + fetchCount) % bufSize) * msgSize;
+
+    set(epid, EpReg::BUF_FETCH_CNT, fetchCount + 1);
+
+    DPRINTF(DtuReg, "EP%u: fetched message @ %#018x\n", epid, msgAddr);
+
+    return msgAddr;
+}
+
 bool
 RegFile::handleRequest(PacketPtr pkt, bool isCpuRequest)
 {
@@ -204,6 +235,9 @@ RegFile::handleRequest(PacketPtr pkt, bool isCpuRequest)
                 reg_t old = dtuRegs[static_cast<Addr>(reg)];
                 set(reg, (old & ~privFlag) | (data[offset / sizeof(reg_t)] & privFlag));
             }
+            // and that the SW can acknowledge errors and choose the endpoints that interrupt it
+            else if(reg == DtuReg::CMD_ERROR || reg == DtuReg::IRQ_EN)
+                set(reg, data[offset / sizeof(reg_t)]);
             else
                 assert(false);
         }
@@ -231,7 +265,13 @@ RegFile::handleRequest(PacketPtr pkt, bool isCpuRequest)
 
             auto reg = static_cast<EpReg>(regNumber);
 
-            if (pkt->isRead())
+            // reading the fetch register fetches the next message, but only for the own core and
+            // only if exactly this register is read. accesses that merely cover it (e.g., due to
+            // speculation or block copies) don't have side effects.
+            if (pkt->isRead() && isCpuRequest && reg == EpReg::BUF_FETCH_MSG &&
+                pkt->getSize() == sizeof(reg_t))
+                data[offset / sizeof(reg_t)] = fetchMessage(epid);
+            else if (pkt->isRead())
                 data[offset / sizeof(reg_t)] = get(epid, reg);
             // writable only from remote and on privileged PEs
             else if(!isCpuRequest || isPrivileged)
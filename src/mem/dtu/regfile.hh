@@ -41,6 +41,10 @@ enum class DtuReg : Addr
 {
     STATUS,
     MSG_CNT,
+    CMD_SLOT,   // the queue slot of the last accepted command
+    CMD_BUSY,   // bitmap of the queue slots with unfinished commands
+    CMD_ERROR,  // slot and error code of the last failed command (writable to acknowledge it)
+    IRQ_EN,     // bitmap of the endpoints that raise an interrupt on new messages (writable)
 };
 
 enum class Status
@@ -48,7 +52,7 @@ enum class Status
     PRIV    = 1 << 0,
 };
 
-constexpr unsigned numDtuRegs = 2;
+constexpr unsigned numDtuRegs = 6;
 
 // registers to issue a command
 enum class CmdReg : Addr
@@ -94,10 +98,13 @@ enum class EpReg : Addr
     // for memory requests
     REQ_REM_ADDR,
     REQ_REM_SIZE,
-    REQ_FLAGS
+    REQ_FLAGS,
+    // for fetching messages
+    BUF_FETCH_MSG,  // reading returns the address of the next unfetched message or 0
+    BUF_FETCH_CNT,  // the number of fetched, but not yet acknowledged messages
 };
 
-constexpr unsigned numEpRegs = 14;
+constexpr unsigned numEpRegs = 16;
 
 class RegFile
 {
@@ -121,6 +128,9 @@ class RegFile
 
     void set(unsigned epid, EpReg reg, reg_t value);
 
+    /// fetches the next message of the receive buffer of <epid> and returns its address (0 if none)
+    reg_t fetchMessage(unsigned epid);
+
     /// returns true if the command register was written
     bool handleRequest(PacketPtr pkt, bool isCpuRequest);
 
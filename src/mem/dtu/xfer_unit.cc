@@ -38,20 +38,70 @@
 
 XferUnit::XferUnit(Dtu &_dtu, size_t _blockSize, size_t _bufCount, size_t _bufSize)
     : dtu(_dtu),
-      blockSize(_blockSize),
-      bufCount(_bufCount),
-      bufSize(_bufSize),
-      bufs(new Buffer*[bufCount])
+      blockSize(),
+      bufCount(),
+      bufSize(),
+      bufs(),
+      freeBufs(),
+      waiters()
 {
-    for(size_t i = 0; i < bufCount; ++i)
-        bufs[i] = new Buffer(*this, i, bufSize);
+    resize(_blockSize, _bufCount, _bufSize);
 }
 
 XferUnit::~XferUnit()
 {
+    for(auto ev : waiters)
+        delete ev;
+
+    for(size_t i = 0; i < bufCount; ++i)
+        delete bufs[i];
+    delete[] bufs;
+}
+
+void
+XferUnit::resize(size_t _blockSize, size_t _bufCount, size_t _bufSize)
+{
+    fatal_if(freeBufs.size() != bufCount || !waiters.empty(),
+             "%s: cannot change the buffers during a transfer\n", name());
+
     for(size_t i = 0; i < bufCount; ++i)
         delete bufs[i];
     delete[] bufs;
+
+    blockSize = _blockSize;
+    bufCount = _bufCount;
+    bufSize = _bufSize;
+    bufs = new Buffer*[bufCount];
+    freeBufs.clear();
+
+    for(size_t i = 0; i < bufCount; ++i)
+        bufs[i] = new Buffer(*this, i);
+
+    // hand out the buffers in ascending order
+    for(size_t i = bufCount; i > 0; --i)
+        freeBufs.push_back(bufs[i - 1]);
+}
+
+void
+XferUnit::regStats()
+{
+    bufOccupancy
+        .name(name() + ".bufOccupancy")
+        .desc("Average number of buffers in use");
+    bufWaiters
+        .name(name() + ".bufWaiters")
+        .desc("Average number of transfers waiting for a buffer");
+    transfers
+        .name(name() + ".transfers")
+        .desc("Number of transfers");
+    delayedTransfers
+        .name(name() + ".delayedTransfers")
+        .desc("Number of transfers that had to wait for a buffer");
+    bufWaitTime
+        .init(16)
+        .name(name() + ".bufWaitTime")
+        .desc("Cycles a transfer waited for a buffer")
+        .flags(Stats::nozero);
 }
 
 void
@@ -64,17 +114,13 @@ XferUnit::TransferEvent::process()
 
     bool writing = type == Dtu::TransferType::REMOTE_WRITE || type == Dtu::TransferType::LOCAL_WRITE;
 
+    // let the memory access the buffer directly; there is only one request at a time per buffer
     auto cmd = writing ? MemCmd::WriteReq : MemCmd::ReadReq;
-    auto pkt = xfer.dtu.generateRequest(localAddr, reqSize, cmd);
+    auto pkt = xfer.dtu.generateRequest(localAddr, reqSize, cmd,
+                                        buf->bytes + buf->offset, NULL);
 
     if(writing)
-    {
-        assert(buf->offset + reqSize <= xfer.bufSize);
-
-        memcpy(pkt->getPtr<uint8_t>(), buf->bytes + buf->offset, reqSize);
-
         buf->offset += reqSize;
-    }
 
     DPRINTFS(DtuXfers, (&xfer.dtu), "buf%d: %s %lu bytes @ %p in local memory\n",
              buf->id,
@@ -92,37 +138,69 @@ XferUnit::TransferEvent::process()
     size -= reqSize;
 }
 
-bool
+void
 XferUnit::startTransfer(Dtu::TransferType type,
                         NocAddr remoteAddr,
                         Addr localAddr,
-                        Addr size,
+                        size_t size,
                         PacketPtr pkt,
                         Dtu::MessageHeader* header,
                         Cycles delay,
-                        bool last)
+                        unsigned cmdSlot)
 {
     Buffer *buf = allocateBuf();
 
-    bool writing = type == Dtu::TransferType::REMOTE_WRITE || type == Dtu::TransferType::LOCAL_WRITE;
+    transfers++;
 
-    // try again later, if there is no free buffer
+    // wait until a buffer is released, if there is no free one
     if(!buf)
     {
+        bool writing = type == Dtu::TransferType::REMOTE_WRITE ||
+                       type == Dtu::TransferType::LOCAL_WRITE;
+
         DPRINTFS(DtuXfers, (&dtu), "Delaying %s transfer of %lu bytes @ %p (all buffers busy)\n",
                  writing ? "mem-write" : "mem-read",
                  size,
                  localAddr);
 
-        auto event = new StartEvent(*this, type, remoteAddr, localAddr, size, pkt, header, last);
+        auto event = new StartEvent(*this, type, remoteAddr, localAddr, size, pkt, header,
+                                    cmdSlot, dtu.clockEdge(Cycles(delay + 1)));
+        waiters.push_back(event);
+
+        delayedTransfers++;
+        bufWaiters = waiters.size();
+        return;
+    }
 
-        dtu.schedule(event, dtu.clockEdge(Cycles(delay + 1)));
+    bufWaitTime.sample(0);
 
-        return false;
+    if (dtu.trace)
+    {
+        auto &rec = dtu.trace->add(DtuTrace::Event::BUF_ALLOC);
+        rec.slot = buf->id;
+        rec.kind = static_cast<uint8_t>(type);
+        rec.size = size;
     }
 
+    startWithBuffer(buf, type, remoteAddr, localAddr, size, pkt, header, delay, cmdSlot);
+}
+
+void
+XferUnit::startWithBuffer(Buffer *buf,
+                          Dtu::TransferType type,
+                          NocAddr remoteAddr,
+                          Addr localAddr,
+                          size_t size,
+                          PacketPtr pkt,
+                          Dtu::MessageHeader* header,
+                          Cycles delay,
+                          unsigned cmdSlot)
+{
+    bool writing = type == Dtu::TransferType::REMOTE_WRITE || type == Dtu::TransferType::LOCAL_WRITE;
+
     // use that buffer and start transferring the data into it
     assert(buf->event.size == 0);
+    assert(size <= bufSize);
 
     buf->event.type = type;
     buf->event.remoteAddr = remoteAddr;
@@ -130,9 +208,24 @@ XferUnit::startTransfer(Dtu::TransferType type,
     buf->event.size = size;
     buf->event.pkt = NULL;
     buf->event.isMsg = false;
-    buf->event.last = last;
+    buf->event.cmdSlot = cmdSlot;
+
+    if(pkt)
+    {
+        // work directly on the data of the packet; for writes, it contains the data to write and
+        // for reads, the data is read into it so that we can simply turn it into the response.
+        // the packet stays alive until we are done with the transfer.
+        buf->bytes = pkt->getPtr<uint8_t>();
+        buf->event.pkt = pkt;
+    }
+    else
+    {
+        // local reads end up in a NoC packet, which shares the payload with us
+        size_t total = size + (header ? sizeof(Dtu::MessageHeader) : 0);
+        buf->payload = dtu.allocPayload(total);
+        buf->bytes = buf->payload->data;
+    }
 
-    // if there is data to put into the buffer, do that now
     if(header)
     {
         // note that this causes no additional delay because we assume that we create the header
@@ -144,13 +237,6 @@ XferUnit::startTransfer(Dtu::TransferType type,
         buf->offset += sizeof(Dtu::MessageHeader);
         delete header;
     }
-    else if(pkt)
-    {
-        // here is also no additional delay, because we are doing that in parallel and are already
-        // paying for it at other places
-        memcpy(buf->bytes, pkt->getPtr<uint8_t>(), pkt->getSize());
-        buf->event.pkt = pkt;
-    }
 
     DPRINTFS(DtuXfers, (&dtu), "buf%d: Starting %s transfer of %lu bytes @ %p\n",
              buf->id,
@@ -163,8 +249,6 @@ XferUnit::startTransfer(Dtu::TransferType type,
     // finish the noc request now to make the port unbusy
     if(type == Dtu::TransferType::REMOTE_READ || type == Dtu::TransferType::REMOTE_WRITE)
         dtu.schedNocRequestFinished(dtu.clockEdge(Cycles(1)));
-
-    return true;
 }
 
 void
@@ -181,9 +265,8 @@ XferUnit::recvMemResponse(size_t bufId,
     if(buf->event.type == Dtu::TransferType::LOCAL_READ ||
        buf->event.type == Dtu::TransferType::REMOTE_READ)
     {
-        assert(buf->offset + size <= bufSize);
-
-        memcpy(buf->bytes + buf->offset, data, size);
+        // the memory has already put the data into the buffer
+        assert(data == buf->bytes + buf->offset);
 
         buf->offset += size;
     }
@@ -200,10 +283,9 @@ XferUnit::recvMemResponse(size_t bufId,
 
             auto pkt = dtu.generateRequest(buf->event.remoteAddr.getAddr(),
                                            buf->offset,
-                                           MemCmd::WriteReq);
-            memcpy(pkt->getPtr<uint8_t>(),
-                   buf->bytes,
-                   buf->offset);
+                                           MemCmd::WriteReq,
+                                           buf->bytes,
+                                           buf->payload);
 
             /*
              * See sendNocMessage() for an explanation of delay handling.
@@ -212,13 +294,17 @@ XferUnit::recvMemResponse(size_t bufId,
             delay += dtu.ticksToCycles(headerDelay);
             pkt->payloadDelay = payloadDelay;
             dtu.printPacket(pkt);
-            auto type = buf->event.isMsg ? Dtu::NocPacketType::MESSAGE : Dtu::NocPacketType::WRITE_REQ; 
-            dtu.sendNocRequest(type, pkt, delay);
+            if(buf->event.isMsg)
+                dtu.sendNocMessage(pkt, delay, buf->event.cmdSlot);
+            else
+            {
+                dtu.sendNocRequest(Dtu::NocPacketType::WRITE_REQ, pkt, delay, false,
+                                   buf->event.cmdSlot);
+            }
         }
         else if(buf->event.type == Dtu::TransferType::LOCAL_WRITE)
         {
-            if(buf->event.last)
-                dtu.scheduleFinishOp(Cycles(1));
+            dtu.completeLocalWrite(buf->event.cmdSlot, buf->offset);
 
             dtu.freeRequest(buf->event.pkt);
         }
@@ -227,6 +313,15 @@ XferUnit::recvMemResponse(size_t bufId,
             // TODO should we respond earlier for remote reads? i.e. as soon as its in the buffer
             assert(buf->event.pkt != NULL);
 
+            // a received message is completely in memory now, so that the core can fetch it
+            if(buf->event.type == Dtu::TransferType::REMOTE_WRITE)
+            {
+                PacketPtr pkt = buf->event.pkt;
+                auto senderState = dynamic_cast<Dtu::NocSenderState*>(pkt->senderState);
+                if(senderState->packetType == Dtu::NocPacketType::MESSAGE)
+                    dtu.messageReceived(NocAddr(pkt->getAddr()).epId);
+            }
+
             // some requests from the cache (e.g. cleanEvict) do not need a response
             if(buf->event.pkt->needsResponse())
             {
@@ -236,9 +331,6 @@ XferUnit::recvMemResponse(size_t bufId,
 
                 buf->event.pkt->makeResponse();
 
-                if(buf->event.type == Dtu::TransferType::REMOTE_READ)
-                    memcpy(buf->event.pkt->getPtr<uint8_t>(), buf->bytes, buf->offset);
-
                 Cycles delay = dtu.transferToNocLatency;
                 dtu.schedNocResponse(buf->event.pkt, dtu.clockEdge(delay));
             }
@@ -248,7 +340,7 @@ XferUnit::recvMemResponse(size_t bufId,
                  buf->id);
 
         // we're done with this buffer now
-        buf->free = true;
+        freeBuf(buf);
     }
     else
         buf->event.process();
@@ -257,15 +349,62 @@ XferUnit::recvMemResponse(size_t bufId,
 XferUnit::Buffer*
 XferUnit::allocateBuf()
 {
-    for(size_t i = 0; i < bufCount; ++i)
+    if(freeBufs.empty())
+        return NULL;
+
+    Buffer *buf = freeBufs.back();
+    freeBufs.pop_back();
+
+    assert(buf->free);
+    buf->free = false;
+    buf->offset = 0;
+
+    bufOccupancy = bufCount - freeBufs.size();
+    return buf;
+}
+
+void
+XferUnit::freeBuf(Buffer *buf)
+{
+    assert(!buf->free);
+
+    if(buf->payload)
     {
-        if(bufs[i]->free)
+        dtu.releasePayload(buf->payload);
+        buf->payload = NULL;
+    }
+    buf->bytes = NULL;
+
+    if (dtu.trace)
+        dtu.trace->add(DtuTrace::Event::BUF_FREE).slot = buf->id;
+
+    // if somebody is waiting, hand the buffer over directly
+    if(!waiters.empty())
+    {
+        StartEvent *ev = waiters.front();
+        waiters.pop_front();
+        bufWaiters = waiters.size();
+
+        DPRINTFS(DtuXfers, (&dtu), "buf%d: Handing over to delayed transfer\n", buf->id);
+
+        buf->offset = 0;
+        ev->buf = buf;
+
+        if (dtu.trace)
         {
-            bufs[i]->free = false;
-            bufs[i]->offset = 0;
-            return bufs[i];
+            auto &rec = dtu.trace->add(DtuTrace::Event::BUF_ALLOC);
+            rec.slot = buf->id;
+            rec.kind = static_cast<uint8_t>(ev->type);
+            rec.size = ev->size;
         }
+        dtu.schedule(ev, std::max(ev->readyTick, dtu.clockEdge(Cycles(1))));
+        return;
     }
 
-    return NULL;
+    buf->free = true;
+    freeBufs.push_back(buf);
+
+    bufOccupancy = bufCount - freeBufs.size();
+
+    dtu.checkDrained();
 }
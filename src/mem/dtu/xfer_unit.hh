@@ -31,6 +31,9 @@
 #ifndef __MEM_DTU_XFER_UNIT_HH__
 #define __MEM_DTU_XFER_UNIT_HH__
 
+#include <deque>
+
+#include "base/statistics.hh"
 #include "mem/dtu/dtu.hh"
 #include "mem/dtu/noc_addr.hh"
 
@@ -52,7 +55,7 @@ class XferUnit
         size_t size;
         PacketPtr pkt;
         bool isMsg;
-        bool last;
+        unsigned cmdSlot;
 
         TransferEvent(XferUnit& _xfer)
             : xfer(_xfer),
@@ -63,7 +66,7 @@ class XferUnit
               size(),
               pkt(),
               isMsg(),
-              last()
+              cmdSlot()
         {}
 
         void process() override;
@@ -73,31 +76,35 @@ class XferUnit
         const std::string name() const override { return xfer.dtu.name(); }
     };
 
+    /**
+     * A buffer does not hold the data itself, but points to the payload of the packet that is
+     * involved in the transfer. That is, the data is read from memory directly into the packet that
+     * is sent over the NoC and written to memory directly from the packet we received.
+     */
     struct Buffer
     {
-        Buffer(XferUnit& _xfer, int _id, size_t size)
+        Buffer(XferUnit& _xfer, int _id)
             : id(_id),
               event(_xfer),
-              bytes(new uint8_t[size]),
+              bytes(),
+              payload(),
               offset(),
               free(true)
         {
             event.buf = this;
         }
 
-        ~Buffer()
-        {
-            delete[] bytes;
-        }
-
         int id;
         TransferEvent event;
+        // the data of the transfer
         uint8_t *bytes;
+        // the payload we own for local reads (NULL if <bytes> belongs to a packet)
+        Payload *payload;
         size_t offset;
         bool free;
     };
 
-    struct StartEvent : public Event
+    struct StartEvent : public PooledEvent<StartEvent>
     {
         XferUnit& xfer;
 
@@ -107,7 +114,13 @@ class XferUnit
         size_t size;
         PacketPtr pkt;
         Dtu::MessageHeader* header;
-        bool last;
+        unsigned cmdSlot;
+        // the earliest point in time to start the transfer
+        Tick readyTick;
+        // when we started to wait for a buffer
+        Tick waitStart;
+        // the buffer that has been handed over to us
+        Buffer *buf;
 
         StartEvent(XferUnit& _xfer,
                    Dtu::TransferType _type,
@@ -116,27 +129,34 @@ class XferUnit
                    size_t _size,
                    PacketPtr _pkt,
                    Dtu::MessageHeader* _header,
-                   bool _last)
-            : xfer(_xfer),
+                   unsigned _cmdSlot,
+                   Tick _readyTick)
+            : PooledEvent<StartEvent>(Default_Pri, AutoDelete),
+              xfer(_xfer),
               type(_type),
               remoteAddr(_remoteAddr),
               localAddr(_localAddr),
               size(_size),
               pkt(_pkt),
               header(_header),
-              last(_last)
+              cmdSlot(_cmdSlot),
+              readyTick(_readyTick),
+              waitStart(curTick()),
+              buf()
         {}
 
         void process() override
         {
+            xfer.bufWaitTime.sample(xfer.dtu.ticksToCycles(curTick() - waitStart));
+
             // the delay was already paid earlier
-            if(xfer.startTransfer(type, remoteAddr, localAddr, size, pkt, header, Cycles(0), last))
-                setFlags(AutoDelete);
+            xfer.startWithBuffer(buf, type, remoteAddr, localAddr, size, pkt, header,
+                                 Cycles(0), cmdSlot);
         }
 
         const char* description() const override { return "StartXferEvent"; }
 
-        const std::string name() const override { return xfer.dtu.name(); }
+        const std::string name() const override { return xfer.name(); }
     };
 
   public:
@@ -145,14 +165,25 @@ class XferUnit
 
     ~XferUnit();
 
-    bool startTransfer(Dtu::TransferType type,
+    const std::string name() const { return dtu.name() + ".xfer"; }
+
+    void regStats();
+
+    /**
+     * Changes the block size and the buffers. All buffers need to be free.
+     */
+    void resize(size_t blockSize, size_t bufCount, size_t bufSize);
+
+    bool isIdle() const { return freeBufs.size() == bufCount && waiters.empty(); }
+
+    void startTransfer(Dtu::TransferType type,
                        NocAddr remoteAddr,
                        Addr localAddr,
                        size_t size,
                        PacketPtr pkt,
                        Dtu::MessageHeader* header,
                        Cycles delay,
-                       bool last);
+                       unsigned cmdSlot);
 
     void recvMemResponse(size_t bufId,
                          const void* data,
@@ -162,8 +193,20 @@ class XferUnit
 
   private:
 
+    void startWithBuffer(Buffer *buf,
+                         Dtu::TransferType type,
+                         NocAddr remoteAddr,
+                         Addr localAddr,
+                         size_t size,
+                         PacketPtr pkt,
+                         Dtu::MessageHeader* header,
+                         Cycles delay,
+                         unsigned cmdSlot);
+
     Buffer* allocateBuf();
 
+    void freeBuf(Buffer *buf);
+
   private:
 
     Dtu &dtu;
@@ -173,6 +216,18 @@ class XferUnit
     size_t bufCount;
     size_t bufSize;
     Buffer **bufs;
+
+    // the buffers that are currently not in use
+    std::vector<Buffer*> freeBufs;
+
+    // the transfers that wait for a buffer, in FIFO order
+    std::deque<StartEvent*> waiters;
+
+    Stats::Average bufOccupancy;
+    Stats::Average bufWaiters;
+    Stats::Scalar transfers;
+    Stats::Scalar delayedTransfers;
+    Stats::Histogram bufWaitTime;
 };
 
 #endif
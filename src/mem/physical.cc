@@ -44,12 +44,17 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
 #include <string>
 
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/AddrRanges.hh"
 #include "debug/Checkpoint.hh"
@@ -70,11 +75,95 @@
 
 using namespace std;
 
+/**
+ * A page image consists of a header, the non-zero pages and the page
+ * table. The header and all pages are padded to the page size, so that
+ * the pages can be mapped from the file directly. A page table entry
+ * of zero denotes a zero page. Otherwise, the upper bits select the
+ * image file (0 is the image itself, n its n-th parent) and the lower
+ * bits hold the offset of the page in this file. As the parents are
+ * referred to by path, each image has a random id, which the children
+ * record as well to detect replaced parents.
+ */
+struct PageImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pageSize;
+    uint64_t numPages;
+    uint64_t tableOffset;
+    uint64_t id;
+};
+
+static const char pageImageMagic[8] = {'G','E','M','5','P','M','E','M'};
+static const uint32_t pageImageVersion = 1;
+
+static const unsigned pageFileShift = 56;
+static const uint64_t pageOffsetMask = (1ULL << pageFileShift) - 1;
+static const size_t maxPageFiles = 1 << (64 - pageFileShift);
+
+// stay well below the default limit of mappings per process
+static const size_t maxPageMappings = 16384;
+
+static string
+absolutePath(const string &dir, const string &file)
+{
+    char *real = realpath(dir.c_str(), NULL);
+    if (!real)
+        fatal("Can't resolve checkpoint directory '%s'\n", dir);
+    string res = string(real) + "/" + file;
+    free(real);
+    return res;
+}
+
+static uint64_t
+newImageId()
+{
+    static mt19937_64 gen(random_device{}());
+    uint64_t id;
+    // zero denotes no id
+    while ((id = gen()) == 0)
+        ;
+    return id;
+}
+
+static uint8_t *
+mapImageFile(const string &path, size_t &size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open page image '%s'\n", path);
+
+    size = lseek(fd, 0, SEEK_END);
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        fatal("Can't map page image '%s'\n", path);
+    return static_cast<uint8_t*>(addr);
+}
+
+static bool
+isZeroPage(const uint8_t *page, size_t size)
+{
+    const uint64_t *words = reinterpret_cast<const uint64_t*>(page);
+    for (size_t i = 0; i < size / sizeof(uint64_t); ++i) {
+        if (words[i] != 0)
+            return false;
+    }
+    for (size_t i = size & ~(sizeof(uint64_t) - 1); i < size; ++i) {
+        if (page[i] != 0)
+            return false;
+    }
+    return true;
+}
+
 PhysicalMemory::PhysicalMemory(const string& _name,
                                const vector<AbstractMemory*>& _memories,
-                               bool mmap_using_noreserve) :
+                               bool mmap_using_noreserve,
+                               Enums::PmemCheckpointFormat cpt_format) :
     _name(_name), rangeCache(addrMap.end()), size(0),
-    mmapUsingNoReserve(mmap_using_noreserve)
+    mmapUsingNoReserve(mmap_using_noreserve),
+    cptFormat(cpt_format)
 {
     if (mmap_using_noreserve)
         warn("Not reserving swap space. May cause SIGSEGV on actual usage\n");
@@ -220,6 +309,62 @@ PhysicalMemory::isMemAddr(Addr addr) const
     }
 }
 
+bool
+PhysicalMemory::mapFile(Addr addr, const string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        fatal("Can't open '%s' for reading: %s\n", filename,
+              strerror(errno));
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= 0) {
+        close(fd);
+        return true;
+    }
+
+    // find the backing store that holds the complete file
+    AddrRange file_range = RangeSize(addr, size);
+    auto s = find_if(backingStore.begin(), backingStore.end(),
+                     [&file_range] (const pair<AddrRange, uint8_t*> &store) {
+                         return file_range.isSubset(store.first);
+                     });
+    if (s == backingStore.end()) {
+        close(fd);
+        return false;
+    }
+
+    uint64_t offset = addr - s->first.start();
+    uint8_t *pmem = s->second + offset;
+
+    // the last page of the file might be partial, which we can't map,
+    // and neither can we map to an address that is not page aligned
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_len = 0;
+    if (offset % page_size == 0)
+        map_len = size & ~(uint64_t)(page_size - 1);
+
+    if (map_len > 0) {
+        void *res = mmap(pmem, map_len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (res == MAP_FAILED)
+            fatal("Can't map '%s' to physical memory: %s\n", filename,
+                  strerror(errno));
+    }
+
+    if (map_len < (size_t)size) {
+        size_t rem = size - map_len;
+        if (pread(fd, pmem + map_len, rem, map_len) != (ssize_t)rem)
+            fatal("Read failed on '%s'\n", filename);
+    }
+
+    close(fd);
+
+    DPRINTF(AddrRanges, "Loaded '%s' to %#x: mapped %d bytes, copied %d\n",
+            filename, addr, map_len, size - map_len);
+    return true;
+}
+
 AddrRangeList
 PhysicalMemory::getConfAddrRanges() const
 {
@@ -322,6 +467,11 @@ void
 PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
                                AddrRange range, uint8_t* pmem) const
 {
+    if (cptFormat != Enums::gzip) {
+        serializeStorePages(cp, store_id, range, pmem);
+        return;
+    }
+
     // we cannot use the address range for the name as the
     // memories that are not part of the address map can overlap
     string filename = name() + ".store" + to_string(store_id) + ".pmem";
@@ -401,6 +551,13 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
     UNSERIALIZE_SCALAR(filename);
     string filepath = cp.cptDir + "/" + filename;
 
+    // checkpoints without format are gzip'ed
+    string format;
+    if (optParamIn(cp, "format", format, false) && format == "pages") {
+        unserializeStorePages(cp, store_id, filename);
+        return;
+    }
+
     // mmap memoryfile
     gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
     if (compressed_mem == NULL)
@@ -448,3 +605,285 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
         fatal("Close failed on physical memory checkpoint file '%s'\n",
               filename);
 }
+
+void
+PhysicalMemory::serializeStorePages(CheckpointOut &cp, unsigned int store_id,
+                                    AddrRange range, uint8_t* pmem) const
+{
+    string filename = name() + ".store" + to_string(store_id) + ".pages";
+    string format = "pages";
+    long range_size = range.size();
+
+    SERIALIZE_SCALAR(store_id);
+    SERIALIZE_SCALAR(filename);
+    SERIALIZE_SCALAR(format);
+    SERIALIZE_SCALAR(range_size);
+
+    string filepath = absolutePath(CheckpointIn::dir(), filename);
+
+    PageImage image;
+    image.files.push_back(filepath);
+    image.ids.push_back(newImageId());
+    image.pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t num_pages = divCeil(range.size(), image.pageSize);
+    image.table.resize(num_pages, 0);
+
+    // use the last image as parent, if it matches. the image must not
+    // be the one we are about to replace.
+    const PageImage *parent = nullptr;
+    if (cptFormat == Enums::delta && store_id < pageImages.size()) {
+        const PageImage &last = pageImages[store_id];
+        if (last.pageSize == image.pageSize &&
+            last.table.size() == num_pages &&
+            last.files.size() < maxPageFiles &&
+            find(last.files.begin(), last.files.end(), filepath) ==
+                last.files.end()) {
+            parent = &last;
+        }
+    }
+
+    vector<pair<uint8_t*, size_t>> parent_maps;
+    if (parent) {
+        for (const auto &f : parent->files) {
+            size_t fsize;
+            uint8_t *addr = mapImageFile(f, fsize);
+            parent_maps.push_back(make_pair(addr, fsize));
+        }
+        image.files.insert(image.files.end(),
+                           parent->files.begin(), parent->files.end());
+        image.ids.insert(image.ids.end(),
+                         parent->ids.begin(), parent->ids.end());
+    }
+
+    unsigned num_parents = image.files.size() - 1;
+    SERIALIZE_SCALAR(num_parents);
+    for (unsigned i = 0; i < num_parents; ++i) {
+        paramOut(cp, csprintf("parent%d", i), image.files[i + 1]);
+        paramOut(cp, csprintf("parent%d_id", i), image.ids[i + 1]);
+    }
+
+    DPRINTF(Checkpoint, "Serializing physical memory %s with size %d "
+            "(%d parents)\n", filename, range_size, num_parents);
+
+    // don't overwrite the file, because it might still be mapped from
+    // restoring an earlier checkpoint
+    unlink(filepath.c_str());
+    FILE *file = fopen(filepath.c_str(), "wb");
+    if (file == NULL)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    vector<uint8_t> zeros(image.pageSize, 0);
+    uint64_t offset = image.pageSize;
+    if (fseek(file, offset, SEEK_SET) != 0)
+        fatal("Seek failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    uint64_t written_pages = 0;
+    for (uint64_t i = 0; i < num_pages; ++i) {
+        const uint8_t *page = pmem + i * image.pageSize;
+        size_t len = min<uint64_t>(image.pageSize,
+                                   range.size() - i * image.pageSize);
+        if (isZeroPage(page, len))
+            continue;
+
+        if (parent) {
+            uint64_t entry = parent->table[i];
+            if (entry != 0) {
+                const auto &map = parent_maps[entry >> pageFileShift];
+                uint64_t poff = entry & pageOffsetMask;
+                if (poff + len <= map.second &&
+                    memcmp(page, map.first + poff, len) == 0) {
+                    image.table[i] = entry + (1ULL << pageFileShift);
+                    continue;
+                }
+            }
+        }
+
+        if (fwrite(page, 1, len, file) != len ||
+            (len < image.pageSize &&
+             fwrite(&zeros[0], 1, image.pageSize - len, file) !=
+                image.pageSize - len)) {
+            fatal("Write failed on physical memory checkpoint file '%s'\n",
+                  filename);
+        }
+
+        image.table[i] = offset;
+        offset += image.pageSize;
+        written_pages++;
+    }
+
+    PageImageHeader header;
+    memcpy(header.magic, pageImageMagic, sizeof(header.magic));
+    header.version = pageImageVersion;
+    header.pageSize = image.pageSize;
+    header.numPages = num_pages;
+    header.tableOffset = offset;
+    header.id = image.ids[0];
+
+    size_t table_size = num_pages * sizeof(uint64_t);
+    if (fwrite(&image.table[0], 1, table_size, file) != table_size ||
+        fseek(file, 0, SEEK_SET) != 0 ||
+        fwrite(&header, 1, sizeof(header), file) != sizeof(header)) {
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filename);
+    }
+
+    if (fclose(file))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    for (auto &map : parent_maps)
+        munmap(map.first, map.second);
+
+    DPRINTF(Checkpoint, "Wrote %d of %d pages of %s\n",
+            written_pages, num_pages, filename);
+
+    // this image is the parent for the next delta checkpoint
+    if (pageImages.size() <= store_id)
+        pageImages.resize(store_id + 1);
+    pageImages[store_id] = image;
+}
+
+void
+PhysicalMemory::unserializeStorePages(CheckpointIn &cp, unsigned int store_id,
+                                      const string &filename)
+{
+    uint8_t* pmem = backingStore[store_id].second;
+    AddrRange range = backingStore[store_id].first;
+
+    long range_size;
+    UNSERIALIZE_SCALAR(range_size);
+
+    if (range_size != range.size())
+        fatal("Memory range size has changed! Saw %lld, expected %lld\n",
+              range_size, range.size());
+
+    PageImage image;
+    image.files.push_back(absolutePath(cp.cptDir, filename));
+    const string &filepath = image.files[0];
+
+    unsigned num_parents;
+    UNSERIALIZE_SCALAR(num_parents);
+    // the id of the image itself is taken from its header below
+    image.ids.push_back(0);
+    for (unsigned i = 0; i < num_parents; ++i) {
+        string parent;
+        uint64_t parent_id;
+        paramIn(cp, csprintf("parent%d", i), parent);
+        paramIn(cp, csprintf("parent%d_id", i), parent_id);
+        image.files.push_back(parent);
+        image.ids.push_back(parent_id);
+    }
+
+    DPRINTF(Checkpoint, "Unserializing physical memory %s with size %d "
+            "(%d parents)\n", filepath, range_size, num_parents);
+
+    PageImageHeader header;
+    vector<int> fds;
+    for (size_t i = 0; i < image.files.size(); ++i) {
+        const string &f = image.files[i];
+        int fd = open(f.c_str(), O_RDONLY);
+        if (fd == -1)
+            fatal("Can't open physical memory checkpoint file '%s'\n", f);
+        fds.push_back(fd);
+
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            memcmp(header.magic, pageImageMagic, sizeof(header.magic)) != 0 ||
+            header.version != pageImageVersion) {
+            fatal("Physical memory checkpoint file '%s' is invalid\n", f);
+        }
+        if (i > 0 && header.id != image.ids[i])
+            fatal("Physical memory checkpoint file '%s' has been replaced "
+                  "since '%s' was created\n", f, filepath);
+    }
+
+    // continue with the header of the image itself
+    if (pread(fds[0], &header, sizeof(header), 0) != sizeof(header))
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filepath);
+    image.ids[0] = header.id;
+
+    image.pageSize = header.pageSize;
+    if (header.numPages != divCeil(range.size(), image.pageSize))
+        fatal("Physical memory checkpoint file '%s' has %llu pages, "
+              "expected %llu\n", filepath, header.numPages,
+              divCeil(range.size(), image.pageSize));
+
+    image.table.resize(header.numPages);
+    size_t table_size = header.numPages * sizeof(uint64_t);
+    if (pread(fds[0], &image.table[0], table_size, header.tableOffset) !=
+            (ssize_t)table_size) {
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filepath);
+    }
+
+    // pages are mapped, if the image's page size is compatible with the
+    // host. otherwise, or if there are too many runs of pages, they are
+    // copied instead.
+    bool map_pages = image.pageSize % sysconf(_SC_PAGESIZE) == 0;
+    size_t mapped = 0;
+    size_t copied = 0;
+    size_t runs = 0;
+
+    uint64_t i = 0;
+    while (i < header.numPages) {
+        uint64_t entry = image.table[i];
+        if (entry == 0) {
+            i++;
+            continue;
+        }
+
+        // find a run of pages that are consecutive in the same file
+        unsigned file = entry >> pageFileShift;
+        if (file >= fds.size())
+            fatal("Physical memory checkpoint file '%s' refers to "
+                  "parent %u, but has only %u\n", filepath, file,
+                  num_parents);
+
+        uint64_t first = i;
+        uint64_t offset = entry & pageOffsetMask;
+        while (++i < header.numPages &&
+               image.table[i] == entry + (i - first) * image.pageSize)
+            ;
+
+        uint8_t *addr = pmem + first * image.pageSize;
+        size_t len = min<uint64_t>((i - first) * image.pageSize,
+                                   range.size() - first * image.pageSize);
+
+        // the last page might be partial, which we can't map
+        size_t map_len = len & ~(uint64_t)(image.pageSize - 1);
+        if (map_pages && map_len > 0 && runs < maxPageMappings) {
+            void *res = mmap(addr, map_len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_FIXED, fds[file], offset);
+            if (res == MAP_FAILED)
+                fatal("Can't map physical memory checkpoint file '%s'\n",
+                      image.files[file]);
+            mapped += map_len;
+            runs++;
+        }
+        else
+            map_len = 0;
+
+        if (map_len < len) {
+            size_t rem = len - map_len;
+            if (pread(fds[file], addr + map_len, rem, offset + map_len) !=
+                    (ssize_t)rem) {
+                fatal("Read failed on physical memory checkpoint file '%s'\n",
+                      image.files[file]);
+            }
+            copied += rem;
+        }
+    }
+
+    for (int fd : fds)
+        close(fd);
+
+    DPRINTF(Checkpoint, "Mapped %d bytes in %d runs and copied %d bytes\n",
+            mapped, runs, copied);
+
+    // this image is the parent for the next delta checkpoint
+    if (pageImages.size() <= store_id)
+        pageImages.resize(store_id + 1);
+    pageImages[store_id] = image;
+}
@@ -41,6 +41,7 @@
 #define __MEM_PHYSICAL_HH__
 
 #include "base/addr_range_map.hh"
+#include "enums/PmemCheckpointFormat.hh"
 #include "mem/packet.hh"
 
 /**
@@ -88,6 +89,29 @@ class PhysicalMemory : public Serializable
     // Let the user choose if we reserve swap space when calling mmap
     const bool mmapUsingNoReserve;
 
+    // The format the backing stores are checkpointed in
+    const Enums::PmemCheckpointFormat cptFormat;
+
+    /**
+     * A page image that a backing store has been checkpointed to or
+     * restored from. Delta checkpoints refer to the pages of this
+     * image that did not change.
+     */
+    struct PageImage
+    {
+        // the absolute paths of the image files; the first is the
+        // image itself, the others are its parents
+        std::vector<std::string> files;
+        // the ids of these files
+        std::vector<uint64_t> ids;
+        // the page table of the image (see physical.cc)
+        std::vector<uint64_t> table;
+        uint32_t pageSize;
+    };
+
+    // The last page image of each backing store, if any
+    mutable std::vector<PageImage> pageImages;
+
     // The physical memory used to provide the memory in the simulated
     // system
     std::vector<std::pair<AddrRange, uint8_t*>> backingStore;
@@ -116,7 +140,8 @@ class PhysicalMemory : public Serializable
      */
     PhysicalMemory(const std::string& _name,
                    const std::vector<AbstractMemory*>& _memories,
-                   bool mmap_using_noreserve);
+                   bool mmap_using_noreserve,
+                   Enums::PmemCheckpointFormat cpt_format);
 
     /**
      * Unmap all the backing store we have used.
@@ -138,6 +163,20 @@ class PhysicalMemory : public Serializable
      */
     bool isMemAddr(Addr addr) const;
 
+    /**
+     * Load a file into the backing store, starting at the given
+     * physical address. Whole pages are mapped copy-on-write from the
+     * file rather than read, so that host memory is only used for the
+     * pages that the simulation actually touches and modifications
+     * never reach the file. The file must therefore not be changed
+     * while the simulation is running.
+     *
+     * @param addr The physical address to load the file to
+     * @param filename The file to load
+     * @return false if there is no backing store covering the file
+     */
+    bool mapFile(Addr addr, const std::string &filename);
+
     /**
      * Get the memory ranges for all memories that are to be reported
      * to the configuration table. The ranges are merged before they
@@ -209,6 +248,18 @@ class PhysicalMemory : public Serializable
     void serializeStore(CheckpointOut &cp, unsigned int store_id,
                         AddrRange range, uint8_t* pmem) const;
 
+    /**
+     * Serialize a specific store into a page image, which skips zero
+     * pages and, for delta checkpoints, pages that did not change
+     * since the last page image of this store.
+     *
+     * @param store_id Unique identifier of this backing store
+     * @param range The address range of this backing store
+     * @param pmem The host pointer to this backing store
+     */
+    void serializeStorePages(CheckpointOut &cp, unsigned int store_id,
+                             AddrRange range, uint8_t* pmem) const;
+
     /**
      * Unserialize the memories in the system. As with the
      * serialization, this action is independent of how the address
@@ -221,6 +272,17 @@ class PhysicalMemory : public Serializable
      */
     void unserializeStore(CheckpointIn &cp);
 
+    /**
+     * Unserialize a specific backing store from a page image. The
+     * pages are mapped copy-on-write from the image files if
+     * possible, so that they are only read on first access.
+     *
+     * @param store_id Unique identifier of this backing store
+     * @param filename The file name of the page image
+     */
+    void unserializeStorePages(CheckpointIn &cp, unsigned int store_id,
+                               const std::string &filename);
+
 };
 
 #endif //__MEM_PHYSICAL_HH__
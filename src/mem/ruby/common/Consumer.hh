@@ -77,11 +77,12 @@ class Consumer
     std::set<Tick> m_scheduled_wakeups;
     ClockedObject *em;
 
-    class ConsumerEvent : public Event
+    class ConsumerEvent : public PooledEvent<ConsumerEvent>
     {
       public:
           ConsumerEvent(Consumer* _consumer)
-              : Event(Default_Pri, AutoDelete), m_consumer_ptr(_consumer)
+              : PooledEvent<ConsumerEvent>(Default_Pri, AutoDelete),
+                m_consumer_ptr(_consumer)
           {
           }
 
@@ -60,11 +60,16 @@ BaseXBar::BaseXBar(const BaseXBarParams *p)
       forwardLatency(p->forward_latency),
       responseLatency(p->response_latency),
       width(p->width),
+      decoder(p->decode_shift),
       gotAddrRanges(p->port_default_connection_count +
                           p->port_master_connection_count, false),
       gotAllAddrRanges(false), defaultPortID(InvalidPortID),
       useDefaultRange(p->use_default_range)
-{}
+{
+    fatal_if(p->decode_shift >= sizeof(Addr) * 8,
+             "%s: decode_shift has to be below %d\n", name(),
+             sizeof(Addr) * 8);
+}
 
 BaseXBar::~BaseXBar()
 {
@@ -326,8 +331,13 @@ BaseXBar::findPort(Addr addr)
     // ranges of all connected slave modules
     assert(gotAllAddrRanges);
 
+    // Check the decode table, which is empty if not enabled
+    PortID dest_id = decoder.lookup(addr);
+    if (dest_id != InvalidPortID)
+        return dest_id;
+
     // Check the cache
-    PortID dest_id = checkPortCache(addr);
+    dest_id = checkPortCache(addr);
     if (dest_id != InvalidPortID)
         return dest_id;
 
@@ -517,6 +527,7 @@ BaseXBar::recvRangeChange(PortID master_port_id)
             s->sendRangeChange();
     }
 
+    decoder.build(portMap);
     clearPortCache();
 }
 
@@ -56,6 +56,7 @@
 #include "base/addr_range_map.hh"
 #include "base/hashmap.hh"
 #include "base/types.hh"
+#include "mem/addr_decoder.hh"
 #include "mem/mem_object.hh"
 #include "mem/qport.hh"
 #include "params/BaseXBar.hh"
@@ -321,6 +322,12 @@ class BaseXBar : public MemObject
 
     AddrRangeMap<PortID> portMap;
 
+    /**
+     * Direct-indexed table in front of the port map for ranges that
+     * cover whole chunks of the configured decode granularity.
+     */
+    AddrDecoder decoder;
+
     /**
      * Remember where request packets came from so that we can route
      * responses to the appropriate port. This relies on the fact that
@@ -924,6 +924,8 @@ class SimObject(object):
     void initState();
     void memInvalidate();
     void memWriteback();
+    void notifyFork();
+    void paramsChanged();
     void regStats();
     void resetStats();
     void regProbePoints();
@@ -1015,6 +1017,7 @@ class SimObject(object):
         self._name = None
         self._ccObject = None  # pointer to C++ object
         self._ccParams = None
+        self._changedParams = set() # params set after creating the C++ object
         self._instantiated = False # really "cloned"
 
         # Clone children specified at class level.  No need for a
@@ -1137,6 +1140,10 @@ class SimObject(object):
             if not (isSimObjectOrVector(value) or\
                     isinstance(value, m5.proxy.BaseProxy)):
                 self._hr_values[attr] = hr_value
+            # the C++ object only sees the change once it is applied
+            # (see applyChangedParams)
+            if self._ccObject:
+                self._changedParams.add(attr)
 
             return
 
@@ -1420,6 +1427,27 @@ class SimObject(object):
         self._ccParams = cc_params
         return self._ccParams
 
+    # Write the parameters that have been changed after the C++ object
+    # has been created to its parameter struct and let the object apply
+    # them. The simulator needs to be drained.
+    def applyChangedParams(self):
+        if not self._changedParams:
+            return
+
+        cc_params = self.getCCParams()
+        for param in sorted(self._changedParams):
+            value = self._values[param]
+            if isproxy(value):
+                value = value.unproxy(self)
+            if isinstance(self._params[param], VectorParamDesc) or \
+               isSimObjectOrVector(value):
+                fatal("%s.%s cannot be changed after instantiation",
+                      self.path(), param)
+            setattr(cc_params, param, value.getValue())
+        self._changedParams.clear()
+
+        self._ccObject.paramsChanged()
+
     # Get C++ object corresponding to this object, calling C++ if
     # necessary to construct it.  Does *not* recursively create
     # children.
@@ -66,4 +66,8 @@ def getEventQueue(index):
 def setEventQueue(eventq):
     internal.event.curEventQueue(eventq)
 
+# only affects event queues that are created afterwards
+def useCalendar(enable):
+    internal.event.cvar.useEventCalendar = enable
+
 __all__ = [ 'create', 'Event', 'ProgressEvent', 'SimExit', 'mainq' ]
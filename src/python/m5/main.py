@@ -82,6 +82,12 @@ def parse_options():
     group("Statistics Options")
     option("--stats-file", metavar="FILE", default="stats.txt",
         help="Sets the output file for statistics [Default: %default]")
+    option("--stats-format", type='choice', default="text",
+        choices=['text', 'binary'],
+        help="Sets the format of the statistics (text or binary, which is "
+             "read by util/gem5stats.py) [Default: %default]")
+    option("--stats-skip-zero", action="store_true", default=False,
+        help="Leave out the stats that are zero in the text output")
 
     # Configuration Options
     group("Configuration Options")
@@ -109,6 +115,12 @@ def parse_options():
     option("--remote-gdb-port", type='int', default=7000,
         help="Remote gdb base port (set to 0 to disable listening)")
 
+    # Event queue options
+    group("Event Queue Options")
+    option("--eventq", type='choice', choices=['list', 'calendar'],
+        help="Keep pending events in a sorted list or a calendar queue "
+             "[Default: chosen at build time]")
+
     # Help options
     group("Help Options")
     option("--list-sim-objects", action='store_true', default=False,
@@ -190,6 +202,9 @@ def main(*args):
 
         fatal("Tracing is not enabled.  Compile with TRACING_ON")
 
+    if options.eventq:
+        event.useCalendar(options.eventq == 'calendar')
+
     # Set the main event queue for the main thread.
     event.mainq = event.getEventQueue(0)
     event.setEventQueue(event.mainq)
@@ -312,7 +327,11 @@ def main(*args):
     sys.path[0:0] = options.path
 
     # set stats options
-    stats.initText(options.stats_file)
+    if options.stats_format == 'binary':
+        stats.initBinary(options.stats_file)
+    else:
+        stats.initText(options.stats_file,
+                       skip_zero=options.stats_skip_zero)
 
     # set debugging options
     debug.setRemoteGDBPort(options.remote_gdb_port)
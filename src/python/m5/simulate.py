@@ -162,6 +162,7 @@ def simulate(*args, **kwargs):
         stats.reset()
 
     if _drain_manager.isDrained():
+        applyParams()
         _drain_manager.resume()
 
     return internal.event.simulate(*args, **kwargs)
@@ -223,6 +224,98 @@ def checkpoint(dir):
     print "Writing checkpoint"
     internal.core.serializeAll(dir)
 
+def applyParams():
+    """Pass the parameters that have been changed after instantiation
+    on to the C++ objects. Objects that cannot handle a change abort the
+    simulation.
+
+    This is done by simulate() whenever the simulator is resumed from
+    the Drained state, e.g., in the children of fork().
+
+    """
+
+    root = objects.Root.getInstance()
+    changed = [ obj for obj in root.descendants() if obj._changedParams ]
+    if not changed:
+        return
+
+    drain()
+    for obj in changed:
+        obj.applyChangedParams()
+
+fork_count = 0
+
+def fork(simout="%(parent)s.f%(fork_seq)i"):
+    """Fork the simulator process.
+
+    The simulator is drained first and continues in both processes from
+    the same point. The child gets its own output directory, named after
+    the simout pattern, which may refer to the output directory of the
+    parent (parent), the number of the fork in the parent (fork_seq) and
+    the process id of the child (pid). Parameters that support it can be
+    changed in the child before calling simulate() again. The parent can
+    fork any number of times.
+
+    Returns the process id of the child in the parent and 0 in the
+    child.
+
+    """
+
+    from m5 import options
+    global fork_count
+
+    if not simout:
+        raise ValueError, "simout argument must be a valid path"
+
+    drain()
+
+    # Only the calling thread survives the fork. The other threads are
+    # created again on the next simulate().
+    internal.event.terminateEventQueueThreads()
+
+    # Everything that is still buffered would be written twice
+    sys.stdout.flush()
+    sys.stderr.flush()
+    internal.core.flushOutputFiles()
+
+    pid = os.fork()
+    if pid == 0:
+        parent = options.outdir
+        options.outdir = simout % {
+            "parent" : parent,
+            "fork_seq" : fork_count,
+            "pid" : os.getpid(),
+        }
+        if not os.path.isdir(options.outdir):
+            os.makedirs(options.outdir)
+
+        # Follow the output redirection of the parent (see main.py)
+        if options.redirect_stdout:
+            stdout_file = os.path.join(options.outdir, options.stdout_file)
+            redir_fd = os.open(stdout_file,
+                               os.O_WRONLY | os.O_CREAT | os.O_TRUNC)
+            os.dup2(redir_fd, sys.stdout.fileno())
+            if not options.redirect_stderr:
+                os.dup2(redir_fd, sys.stderr.fileno())
+        if options.redirect_stderr:
+            stderr_file = os.path.join(options.outdir, options.stderr_file)
+            redir_fd = os.open(stderr_file,
+                               os.O_WRONLY | os.O_CREAT | os.O_TRUNC)
+            os.dup2(redir_fd, sys.stderr.fileno())
+
+        internal.core.setOutputDir(options.outdir)
+
+        root = objects.Root.getInstance()
+        for obj in root.descendants():
+            obj.notifyFork()
+
+        # forks of the child are numbered separately
+        fork_count = 0
+    else:
+        fork_count += 1
+
+    return pid
+
 def _changeMemoryMode(system, mode):
     if not isinstance(system, (objects.Root, objects.System)):
         raise TypeError, "Parameter of type '%s'.  Must be type %s or %s." % \
@@ -35,8 +35,12 @@ from m5.objects import Root
 from m5.util import attrdict, fatal
 
 outputList = []
-def initText(filename, desc=True):
-    output = internal.stats.initText(filename, desc)
+def initText(filename, desc=True, skip_zero=False):
+    output = internal.stats.initText(filename, desc, skip_zero)
+    outputList.append(output)
+
+def initBinary(filename):
+    output = internal.stats.initBinary(filename)
     outputList.append(output)
 
 def initSimStats():
@@ -94,27 +98,26 @@ def prepare():
         stat.prepare()
 
 lastDump = 0
-def dump():
-    '''Dump all statistics data to the registered outputs'''
+def dump(select=None):
+    '''Dump all statistics data to the registered outputs. If select is
+    given, only the stats whose names match one of the expressions in it
+    are dumped, e.g., ['system.pe3', 'system.*.dtu'].'''
 
     curTick = m5.curTick()
 
-    global lastDump
-    assert lastDump <= curTick
-    if lastDump == curTick:
-        return
-    lastDump = curTick
+    # a partial dump does not replace the full one at this tick
+    if not select:
+        global lastDump
+        assert lastDump <= curTick
+        if lastDump == curTick:
+            return
+        lastDump = curTick
 
     internal.stats.processDumpQueue()
 
-    prepare()
-
     for output in outputList:
         if output.valid():
-            output.begin()
-            for stat in stats_list:
-                output.visit(stat)
-            output.end()
+            internal.stats.dumpOutput(output, select or [])
 
 def reset():
     '''Reset all statistics to the base state'''
@@ -69,6 +69,7 @@ seedRandom(uint64_t seed)
 %include "base/types.hh"
 
 void setOutputDir(const std::string &dir);
+void flushOutputFiles();
 void doExitCleanup();
 void disableAllListeners();
 void seedRandom(uint64_t seed);
@@ -105,6 +105,7 @@ class GlobalSimLoopExitEvent
 }
 
 GlobalSimLoopExitEvent *simulate(Tick num_cycles = MaxTick);
+void terminateEventQueueThreads();
 void exitSimLoop(const std::string &message, int exit_code);
 void curEventQueue( EventQueue *);
 EventQueue *getEventQueue(uint32_t index);
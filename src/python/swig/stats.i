@@ -36,6 +36,7 @@
 %include <stdint.i>
 
 %{
+#include "base/stats/binary.hh"
 #include "base/stats/text.hh"
 #include "base/stats/types.hh"
 #include "base/callback.hh"
@@ -135,7 +136,9 @@ template <class T> T cast_info(Info *info);
 %template(dynamic_SparseHistInfo) cast_info<SparseHistInfo *>;
 
 void initSimStats();
-Output *initText(const std::string &filename, bool desc);
+Output *initText(const std::string &filename, bool desc,
+                 bool skipZero = false);
+Output *initBinary(const std::string &filename);
 
 void registerPythonStatsHandlers();
 
@@ -148,6 +151,7 @@ void updateEvents();
 
 void processResetQueue();
 void processDumpQueue();
+void dumpOutput(Output &output, const std::vector<std::string> &select);
 void enable();
 bool enabled();
 
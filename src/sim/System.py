@@ -39,6 +39,8 @@ from SimpleMemory import *
 class MemoryMode(Enum): vals = ['invalid', 'atomic', 'timing',
                                 'atomic_noncaching']
 
+class PmemCheckpointFormat(Enum): vals = ['gzip', 'pages', 'delta']
+
 class System(MemObject):
     type = 'System'
     cxx_header = "sim/system.hh"
@@ -66,6 +68,13 @@ class System(MemObject):
     mmap_using_noreserve = Param.Bool(False, "mmap the backing store " \
                                           "without reserving swap")
 
+    # The backing store is either checkpointed gzip'ed in full or as a
+    # page image, which skips zero pages and is mapped on restore. Delta
+    # checkpoints additionally refer to the unchanged pages of the image
+    # the store was last checkpointed to or restored from.
+    pmem_checkpoint = Param.PmemCheckpointFormat('gzip',
+        "The checkpoint format of the backing store (gzip, pages or delta)")
+
     # The memory ranges are to be populated when creating the system
     # such that these can be passed from the I/O subsystem through an
     # I/O bridge or cache
@@ -98,6 +98,12 @@ setOutputDir(const string &dir)
     simout.setDirectory(dir);
 }
 
+void
+flushOutputFiles()
+{
+    simout.flush();
+}
+
 /**
  * Queue of C++ callbacks to invoke on simulator exit.
  */
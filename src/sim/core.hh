@@ -95,6 +95,9 @@ void setClockFrequency(Tick ticksPerSecond);
 
 void setOutputDir(const std::string &dir);
 
+/** Flush the output files, e.g., before the simulator forks. */
+void flushOutputFiles();
+
 class Callback;
 void registerExitCallback(Callback *callback);
 void doExitCleanup();
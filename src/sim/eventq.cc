@@ -32,7 +32,11 @@
  *          Steve Raasch
  */
 
+#include <cxxabi.h>
+
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -42,7 +46,9 @@
 #include "base/trace.hh"
 #include "cpu/smt.hh"
 #include "debug/Checkpoint.hh"
+#include "debug/EventRecord.hh"
 #include "sim/core.hh"
+#include "sim/eventq_calendar.hh"
 #include "sim/eventq_impl.hh"
 
 using namespace std;
@@ -60,6 +66,12 @@ vector<EventQueue *> mainEventQueue;
 __thread EventQueue *_curEventQueue = NULL;
 bool inParallelMode = false;
 
+#ifdef EVENTQ_CALENDAR
+bool useEventCalendar = true;
+#else
+bool useEventCalendar = false;
+#endif
+
 EventQueue *
 getEventQueue(uint32_t index)
 {
@@ -76,6 +88,82 @@ getEventQueue(uint32_t index)
 Counter Event::instanceCounter = 0;
 #endif
 
+namespace {
+
+// a released event on a free list of the EventPool
+struct FreeEvent
+{
+    FreeEvent *next;
+};
+
+__thread FreeEvent *freeEvents[EventPool::NUM_CLASSES];
+
+}
+
+EventPool::Type::Type(const char *mangledName)
+    : name(mangledName), allocs(0), recycled(0)
+{
+    int status;
+    char *demangled = abi::__cxa_demangle(mangledName, 0, 0, &status);
+    if (status == 0) {
+        name = demangled;
+        std::free(demangled);
+    }
+
+    // turn it into a valid statistics name
+    std::string valid;
+    for (auto c : name) {
+        if (isalnum(static_cast<unsigned char>(c)))
+            valid += c;
+        else if (!valid.empty() && valid.back() != '_')
+            valid += '_';
+    }
+    if (!valid.empty() && valid.back() == '_')
+        valid.pop_back();
+    name = valid;
+
+    types().push_back(this);
+}
+
+std::vector<EventPool::Type *> &
+EventPool::types()
+{
+    static std::vector<Type *> all;
+    return all;
+}
+
+void *
+EventPool::alloc(size_t size, Type &type)
+{
+    type.allocs.fetch_add(1, std::memory_order_relaxed);
+
+    size_t sizeClass = (size - 1) / GRANULE;
+    if (sizeClass >= NUM_CLASSES)
+        return ::operator new(size);
+
+    FreeEvent *ev = freeEvents[sizeClass];
+    if (!ev)
+        return ::operator new((sizeClass + 1) * GRANULE);
+
+    type.recycled.fetch_add(1, std::memory_order_relaxed);
+    freeEvents[sizeClass] = ev->next;
+    return ev;
+}
+
+void
+EventPool::free(void *ptr, size_t size)
+{
+    size_t sizeClass = (size - 1) / GRANULE;
+    if (sizeClass >= NUM_CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FreeEvent *ev = static_cast<FreeEvent *>(ptr);
+    ev->next = freeEvents[sizeClass];
+    freeEvents[sizeClass] = ev;
+}
+
 Event::~Event()
 {
     assert(!scheduled());
@@ -117,6 +205,18 @@ Event::insertBefore(Event *event, Event *curr)
 void
 EventQueue::insert(Event *event)
 {
+    // the EventRecord output can be replayed with the eventqtime unittest
+    DPRINTF(EventRecord, "i %#x %d %d\n", (uintptr_t)event,
+            event->when(), (int)event->priority());
+
+    if (calendar) {
+        calendar->insert(event);
+        // the event is the new top of the head's bin or comes before it
+        if (!head || *event <= *head)
+            head = event;
+        return;
+    }
+
     // Deal with the head case
     if (!head || *event <= *head) {
         head = Event::insertBefore(event, head);
@@ -176,6 +276,16 @@ EventQueue::remove(Event *event)
 
     assert(event->queue == this);
 
+    DPRINTF(EventRecord, "r %#x\n", (uintptr_t)event);
+
+    if (calendar) {
+        bool inHeadBin = *head == *event;
+        Event *top = calendar->remove(event);
+        if (inHeadBin)
+            head = top ? top : calendar->first(event->when());
+        return;
+    }
+
     // deal with an event on the head's 'in bin' list (event has the same
     // time as the head)
     if (*head == *event) {
@@ -208,7 +318,13 @@ EventQueue::serviceOne()
     Event *next = head->nextInBin;
     event->flags.clear(Event::Scheduled);
 
-    if (next) {
+    DPRINTF(EventRecord, "s %#x\n", (uintptr_t)event);
+
+    if (calendar) {
+        // the head is always the first bin in its bucket
+        Event *top = calendar->remove(event);
+        head = top ? top : calendar->first(event->when());
+    } else if (next) {
         // update the next bin pointer since it could be stale
         next->nextBin = head->nextBin;
 
@@ -301,15 +417,12 @@ EventQueue::dump() const
     if (empty())
         cprintf("<No Events>\n");
     else {
-        Event *nextBin = head;
-        while (nextBin) {
-            Event *nextInBin = nextBin;
+        for (auto bin : bins()) {
+            Event *nextInBin = bin;
             while (nextInBin) {
                 nextInBin->dump();
                 nextInBin = nextInBin->nextInBin;
             }
-
-            nextBin = nextBin->nextBin;
         }
     }
 
@@ -324,9 +437,8 @@ EventQueue::debugVerify() const
     Tick time = 0;
     short priority = 0;
 
-    Event *nextBin = head;
-    while (nextBin) {
-        Event *nextInBin = nextBin;
+    for (auto bin : bins()) {
+        Event *nextInBin = bin;
         while (nextInBin) {
             if (nextInBin->when() < time) {
                 cprintf("time goes backwards!");
@@ -351,17 +463,32 @@ EventQueue::debugVerify() const
 
             nextInBin = nextInBin->nextInBin;
         }
-
-        nextBin = nextBin->nextBin;
     }
 
     return true;
 }
 
+std::vector<Event *>
+EventQueue::bins() const
+{
+    if (calendar)
+        return calendar->bins();
+
+    std::vector<Event *> res;
+    for (Event *bin = head; bin; bin = bin->nextBin)
+        res.push_back(bin);
+    return res;
+}
+
 Event*
 EventQueue::replaceHead(Event* s)
 {
     Event* t = head;
+    if (calendar) {
+        // exchange the bins in the form of a list
+        t = calendar->drain();
+        calendar->fill(s);
+    }
     head = s;
     return t;
 }
@@ -415,8 +542,14 @@ Event::dump() const
 }
 
 EventQueue::EventQueue(const string &n)
-    : objName(n), head(NULL), _curTick(0)
+    : objName(n), head(NULL), _curTick(0),
+      calendar(useEventCalendar ? new EventCalendar() : NULL)
+{
+}
+
+EventQueue::~EventQueue()
 {
+    delete calendar;
 }
 
 void
@@ -39,12 +39,15 @@
 #define __SIM_EVENTQ_HH__
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <climits>
 #include <iosfwd>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <typeinfo>
+#include <vector>
 
 #include "base/flags.hh"
 #include "base/misc.hh"
@@ -53,6 +56,7 @@
 #include "sim/serialize.hh"
 
 class EventQueue;       // forward declaration
+class EventCalendar;
 class BaseGlobalEvent;
 
 //! Simulation Quantum for multiple eventq simulation.
@@ -79,6 +83,11 @@ extern __thread EventQueue *_curEventQueue;
 //! Current mode of execution: parallel / serial
 extern bool inParallelMode;
 
+//! Whether newly created event queues keep their bins in a calendar
+//! queue (see EventCalendar) instead of a sorted list. Defaults to
+//! false, unless EVENTQ_CALENDAR is defined at build time.
+extern bool useEventCalendar;
+
 //! Function for returning eventq queue for the provided
 //! index. The function allocates a new queue in case one
 //! does not exist for the index, provided that the index
@@ -188,6 +197,7 @@ class EventBase
 class Event : public EventBase, public Serializable
 {
     friend class EventQueue;
+    friend class EventCalendar;
 
   private:
     // The event queue is now a linked list of linked lists.  The
@@ -199,6 +209,10 @@ class Event : public EventBase, public Serializable
     // linear/constant, and the lookup/removal in 'nextInBin' is
     // constant/constant.  Hopefully this is a significant improvement
     // over the current fully linear insertion.
+    //
+    // If the queue uses an EventCalendar, 'nextBin' links the bins
+    // of one calendar bucket instead, so that only those need to be
+    // walked on insertion.
     Event *nextBin;
     Event *nextInBin;
 
@@ -449,6 +463,10 @@ class EventQueue
     Event *head;
     Tick _curTick;
 
+    //! The calendar that holds the bins or NULL if they are kept in
+    //! a sorted list, starting at head.
+    EventCalendar *calendar;
+
     //! Mutex to protect async queue.
     std::mutex async_queue_mutex;
 
@@ -487,6 +505,9 @@ class EventQueue
     //! owning thread, should call this function instead of insert().
     void asyncInsert(Event *event);
 
+    //! Returns the top events of all bins in ascending order.
+    std::vector<Event *> bins() const;
+
     EventQueue(const EventQueue &);
 
   public:
@@ -661,12 +682,86 @@ class EventQueue
      */
     void checkpointReschedule(Event *event);
 
-    virtual ~EventQueue() { }
+    virtual ~EventQueue();
 };
 
 void dumpMainQueue();
 
 #ifndef SWIG
+/**
+ * Recycles the memory of events that are allocated on the heap for a
+ * single occurrence (typically with the AutoDelete flag). Released
+ * memory is kept on per-thread free lists with 16-byte size classes
+ * instead of being handed back to the allocator. Since events might be
+ * released by a different thread than the one that allocated them,
+ * the memory simply migrates to the free lists of the releasing
+ * thread in this case.
+ */
+class EventPool
+{
+  public:
+    //! The allocation counters of one event type, which are reported
+    //! as sim_events.<type>.* statistics.
+    struct Type
+    {
+        Type(const char *mangledName);
+
+        Counter getAllocs() const
+        { return allocs.load(std::memory_order_relaxed); }
+        Counter getRecycled() const
+        { return recycled.load(std::memory_order_relaxed); }
+
+        std::string name;
+        //! Number of allocated events (shared by all event-queue threads)
+        std::atomic<Counter> allocs;
+        //! Number of allocations that were served from the free lists
+        std::atomic<Counter> recycled;
+    };
+
+    static const size_t GRANULE = 16;
+    static const size_t NUM_CLASSES = 32;
+
+    static void *alloc(size_t size, Type &type);
+    static void free(void *ptr, size_t size);
+
+    //! All event types that might be allocated from the pool
+    static std::vector<Type *> &types();
+};
+
+/**
+ * Base class for events that are allocated via the EventPool. The
+ * derived class passes itself as template argument, which gives each
+ * event type its own allocation counters:
+ *
+ *   class MyEvent : public PooledEvent<MyEvent> { ... };
+ */
+template <class T>
+class PooledEvent : public Event
+{
+  public:
+    PooledEvent(Priority p = Default_Pri, Flags f = 0)
+        : Event(p, f)
+    {}
+
+    static void *
+    operator new(size_t size)
+    {
+        return EventPool::alloc(size, type);
+    }
+
+    static void
+    operator delete(void *ptr, size_t size)
+    {
+        EventPool::free(ptr, size);
+    }
+
+  private:
+    static EventPool::Type type;
+};
+
+template <class T>
+EventPool::Type PooledEvent<T>::type(typeid(T).name());
+
 class EventManager
 {
   protected:
@@ -732,14 +827,15 @@ template <class T, void (T::* F)()>
 void
 DelayFunction(EventQueue *eventq, Tick when, T *object)
 {
-    class DelayEvent : public Event
+    class DelayEvent : public PooledEvent<DelayEvent>
     {
       private:
         T *object;
 
       public:
         DelayEvent(T *o)
-            : Event(Default_Pri, AutoDelete), object(o)
+            : PooledEvent<DelayEvent>(Event::Default_Pri, Event::AutoDelete),
+              object(o)
         { }
         void process() { (object->*F)(); }
         const char *description() const { return "delay"; }
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/misc.hh"
+#include "sim/eventq.hh"
+#include "sim/eventq_calendar.hh"
+
+EventCalendar::EventCalendar()
+    : buckets(MIN_BUCKETS, NULL),
+      mask(MIN_BUCKETS - 1),
+      widthShift(10),
+      numBins(0)
+{
+}
+
+void
+EventCalendar::insert(Event *event)
+{
+    Event **bin = bucketOf(event->when());
+    while (*bin && **bin < *event)
+        bin = &(*bin)->nextBin;
+
+    bool newBin = !*bin || *event < **bin;
+    *bin = Event::insertBefore(event, *bin);
+
+    if (newBin && ++numBins > 2 * buckets.size())
+        rebuild(bins(), 2 * buckets.size());
+}
+
+Event *
+EventCalendar::remove(Event *event)
+{
+    Event **bin = bucketOf(event->when());
+    while (*bin && **bin < *event)
+        bin = &(*bin)->nextBin;
+
+    if (!*bin || **bin != *event)
+        panic("event not found!");
+
+    Event *top = *bin;
+    bool lastInBin = event == top && !top->nextInBin;
+    *bin = Event::removeItem(event, top);
+    if (!lastInBin)
+        return *bin;
+
+    if (--numBins < buckets.size() / 2 && buckets.size() > MIN_BUCKETS)
+        rebuild(bins(), buckets.size() / 2);
+    return NULL;
+}
+
+Event *
+EventCalendar::first(Tick from) const
+{
+    if (numBins == 0)
+        return NULL;
+
+    // walk through the buckets, starting at the one for the given tick,
+    // until we find a bin that falls into the current slot of the bucket
+    Tick slot = slotOf(from);
+    for (size_t i = 0; i < buckets.size(); ++i, ++slot) {
+        Event *bin = buckets[slot & mask];
+        if (bin && slotOf(bin->when()) == slot)
+            return bin;
+    }
+
+    // no bin within a whole round; fall back to a direct search
+    Event *min = NULL;
+    for (auto bin : buckets) {
+        if (bin && (!min || *bin < *min))
+            min = bin;
+    }
+    return min;
+}
+
+std::vector<Event *>
+EventCalendar::bins() const
+{
+    std::vector<Event *> res;
+    res.reserve(numBins);
+    for (auto bin : buckets) {
+        for (; bin; bin = bin->nextBin)
+            res.push_back(bin);
+    }
+
+    std::sort(res.begin(), res.end(),
+        [] (const Event *a, const Event *b) { return *a < *b; });
+    return res;
+}
+
+Event *
+EventCalendar::drain()
+{
+    std::vector<Event *> all = bins();
+    for (size_t i = 0; i + 1 < all.size(); ++i)
+        all[i]->nextBin = all[i + 1];
+    if (!all.empty())
+        all.back()->nextBin = NULL;
+
+    std::fill(buckets.begin(), buckets.end(), (Event*)NULL);
+    numBins = 0;
+    return all.empty() ? NULL : all.front();
+}
+
+void
+EventCalendar::fill(Event *list)
+{
+    assert(numBins == 0);
+
+    std::vector<Event *> all;
+    for (; list; list = list->nextBin)
+        all.push_back(list);
+
+    size_t count = MIN_BUCKETS;
+    while (count < all.size())
+        count *= 2;
+
+    numBins = all.size();
+    rebuild(all, count);
+}
+
+void
+EventCalendar::rebuild(const std::vector<Event *> &all, size_t count)
+{
+    // estimate the bucket width from the average distance between the
+    // earliest bins, ignoring outliers like far-away exit events
+    size_t samples = all.size() < SAMPLE_BINS ? all.size() : SAMPLE_BINS;
+    if (samples > 1) {
+        Tick range = all[samples - 1]->when() - all[0]->when();
+        Tick avg = range / (samples - 1);
+        Tick sum = 0;
+        size_t num = 0;
+        for (size_t i = 1; i < samples; ++i) {
+            Tick dist = all[i]->when() - all[i - 1]->when();
+            if (dist / 2 <= avg) {
+                sum += dist;
+                num++;
+            }
+        }
+
+        // Brown suggests about three times the average distance. the width
+        // has to be a power of two, so we use twice the mean rounded up to
+        // one, i.e., 2 to 4 times the mean
+        Tick width = std::max<Tick>(sum / num, 1);
+        widthShift = std::min(ceilLog2(width) + 1, 63);
+    }
+
+    buckets.assign(count, NULL);
+    mask = count - 1;
+
+    // the bins are sorted, so that appending them keeps the buckets sorted
+    std::vector<Event **> tails(count);
+    for (size_t i = 0; i < count; ++i)
+        tails[i] = &buckets[i];
+    for (auto bin : all) {
+        Event **&tail = tails[slotOf(bin->when()) & mask];
+        *tail = bin;
+        tail = &bin->nextBin;
+    }
+    for (auto tail : tails)
+        *tail = NULL;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+/* @file
+ * Calendar queue for the bins of an EventQueue
+ */
+
+#ifndef __SIM_EVENTQ_CALENDAR_HH__
+#define __SIM_EVENTQ_CALENDAR_HH__
+
+#include <vector>
+
+#include "base/types.hh"
+
+class Event;
+
+/**
+ * A calendar queue (R. Brown, 1988) holding the bins of an EventQueue.
+ *
+ * As in the list-based EventQueue, a bin is the stack of all events
+ * with the same (when, priority) pair and is represented by its top
+ * event. The bins are spread over a power-of-two number of buckets,
+ * each covering a power-of-two number of ticks (the bucket width). A
+ * bucket is a sorted list of bins, linked via Event::nextBin, so that
+ * insertion and removal only walk the bins of one bucket. The bins
+ * themselves are left untouched, so that events are serviced in
+ * exactly the same order as with the list.
+ *
+ * The number of buckets follows the number of bins. The width is
+ * estimated on every resize from the distance between the earliest
+ * bins.
+ */
+class EventCalendar
+{
+  private:
+    static const size_t MIN_BUCKETS = 16;
+    static const size_t SAMPLE_BINS = 25;
+
+    std::vector<Event *> buckets;
+    size_t mask;
+    unsigned widthShift;
+    size_t numBins;
+
+    Tick slotOf(Tick when) const { return when >> widthShift; }
+    Event **bucketOf(Tick when) { return &buckets[slotOf(when) & mask]; }
+
+    void rebuild(const std::vector<Event *> &bins, size_t count);
+
+  public:
+    EventCalendar();
+
+    size_t size() const { return numBins; }
+
+    /**
+     * Pushes the event onto the bin with the same (when, priority)
+     * pair or creates a new bin, if there is none.
+     */
+    void insert(Event *event);
+
+    /**
+     * Removes the event from its bin.
+     *
+     * @return the top event of the bin or NULL if it is empty now
+     */
+    Event *remove(Event *event);
+
+    /**
+     * Finds the earliest bin, given that no bin is before tick from.
+     *
+     * @return the top event of that bin or NULL if there is none
+     */
+    Event *first(Tick from) const;
+
+    /**
+     * @return the top events of all bins in ascending order
+     */
+    std::vector<Event *> bins() const;
+
+    /**
+     * Removes all bins.
+     *
+     * @return the earliest bin, with all bins linked in ascending
+     * order via Event::nextBin
+     */
+    Event *drain();
+
+    /**
+     * Inserts all bins of the given list, which are linked in
+     * ascending order via Event::nextBin.
+     */
+    void fill(Event *list);
+};
+
+#endif // __SIM_EVENTQ_CALENDAR_HH__
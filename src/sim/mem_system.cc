@@ -28,7 +28,7 @@
  */
 
 #include "sim/mem_system.hh"
-#include "mem/port_proxy.hh"
+#include "base/misc.hh"
 #include "params/MemSystem.hh"
 
 MemSystem::MemSystem(Params *p)
@@ -45,26 +45,11 @@ MemSystem::initState()
 {
     System::initState();
 
-    if(!memFile.empty())
-    {
-        FILE *f = fopen(memFile.c_str(), "r");
-        if(!f)
-            panic("Unable to open '%s' for reading", memFile.c_str());
-
-        fseek(f, 0L, SEEK_END);
-        size_t sz = ftell(f);
-        fseek(f, 0L, SEEK_SET);
-
-        // TODO for now, it should not be larger because the PEs use the space from 32MiB
-        assert(sz <= 32 * 1024 * 1024);
-
-        auto data = new uint8_t[sz];
-        if(fread(data, 1, sz, f) != sz)
-            panic("Unable to read '%s'", memFile.c_str());
-        physProxy.writeBlob(0x0, data, sz);
-        delete[] data;
-        fclose(f);
-    }
+    // map the image instead of reading it, so that large images only
+    // cost host memory for the pages that are actually used
+    if(!memFile.empty() && !physmem.mapFile(0, memFile))
+        fatal("Memory image '%s' does not fit into the memory of %s",
+              memFile, name());
 }
 
 MemSystem *
@@ -132,6 +132,13 @@ SimObject::regProbeListeners()
 {
 }
 
+void
+SimObject::paramsChanged()
+{
+    fatal("%s does not support changing its parameters after "
+          "instantiation\n", name());
+}
+
 ProbeManager *
 SimObject::getProbeManager()
 {
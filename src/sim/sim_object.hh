@@ -209,6 +209,28 @@ class SimObject : public EventManager, public Serializable, public Drainable
      */
     virtual void memInvalidate() {};
 
+    /**
+     * Notify a child process of a fork.
+     *
+     * When calling m5.fork() in the Python script, the system is
+     * drained and this method is called in the child afterwards. The
+     * output directory has already been changed at that point, so
+     * objects that keep output files open can start them afresh.
+     */
+    virtual void notifyFork() {};
+
+    /**
+     * Apply parameters that have been changed after instantiation.
+     *
+     * The new values have been written to the parameter struct
+     * (params()) when this method is called and the system is
+     * drained. Objects that support changing some of their parameters
+     * on the fly, e.g., for each child of m5.fork(), override this
+     * method and reject changes they cannot handle. The default does
+     * not support any changes.
+     */
+    virtual void paramsChanged();
+
     void serialize(CheckpointOut &cp) const M5_ATTR_OVERRIDE {};
     void unserialize(CheckpointIn &cp) M5_ATTR_OVERRIDE {};
 
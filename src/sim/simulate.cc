@@ -51,6 +51,13 @@ std::mutex asyncEventMutex;
 //! simulation loop.
 Barrier *threadBarrier;
 
+//! The subordinate threads, created by the first call to simulate().
+static std::vector<std::thread *> threads;
+static bool threads_initialized = false;
+
+//! Tells the subordinate threads to leave thread_loop().
+static bool terminate_threads = false;
+
 //! forward declaration
 Event *doSimLoop(EventQueue *);
 
@@ -67,10 +74,35 @@ thread_loop(EventQueue *queue)
 {
     while (true) {
         threadBarrier->wait();
+        if (terminate_threads)
+            return;
         doSimLoop(queue);
     }
 }
 
+void
+terminateEventQueueThreads()
+{
+    if (!threads_initialized)
+        return;
+
+    // all subordinate threads wait on the barrier outside of the
+    // simulation loop at this point, so releasing them with the flag
+    // set lets them exit.
+    terminate_threads = true;
+    threadBarrier->wait();
+    for (auto t : threads) {
+        t->join();
+        delete t;
+    }
+    threads.clear();
+    terminate_threads = false;
+
+    delete threadBarrier;
+    threadBarrier = NULL;
+    threads_initialized = false;
+}
+
 GlobalSimLoopExitEvent *simulate_limit_event = nullptr;
 
 /** Simulate for num_cycles additional cycles.  If num_cycles is -1
@@ -83,10 +115,8 @@ simulate(Tick num_cycles)
 {
     // The first time simulate() is called from the Python code, we need to
     // create a thread for each of event queues referenced by the
-    // instantiated sim objects.
-    static bool threads_initialized = false;
-    static std::vector<std::thread *> threads;
-
+    // instantiated sim objects. The same is necessary after the threads
+    // have been terminated for a fork.
     if (!threads_initialized) {
         threadBarrier = new Barrier(numMainEventQueues);
 
@@ -98,9 +128,11 @@ simulate(Tick num_cycles)
         }
 
         threads_initialized = true;
-        simulate_limit_event =
-            new GlobalSimLoopExitEvent(mainEventQueue[0]->getCurTick(),
-                                       "simulate() limit reached", 0);
+        if (!simulate_limit_event) {
+            simulate_limit_event =
+                new GlobalSimLoopExitEvent(mainEventQueue[0]->getCurTick(),
+                                           "simulate() limit reached", 0);
+        }
     }
 
     inform("Entering event queue @ %d.  Starting simulation...\n", curTick());
@@ -34,3 +34,11 @@
 
 GlobalSimLoopExitEvent *simulate(Tick num_cycles = MaxTick);
 extern GlobalSimLoopExitEvent *simulate_limit_event;
+
+/**
+ * Terminate the threads that simulate the event queues 1..N-1. They
+ * are created again on the next call to simulate(). This is required
+ * before the process can be forked, because the child would only
+ * inherit the calling thread.
+ */
+void terminateEventQueueThreads();
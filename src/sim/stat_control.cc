@@ -55,6 +55,7 @@
 #include "base/statistics.hh"
 #include "base/time.hh"
 #include "cpu/base.hh"
+#include "sim/eventq.hh"
 #include "sim/global_event.hh"
 #include "sim/stat_control.hh"
 
@@ -116,6 +117,9 @@ struct Global
     Stats::Value simInsts;
     Stats::Value simOps;
 
+    std::list<Stats::Value> eventAllocs;
+    std::list<Stats::Value> eventsRecycled;
+
     Global();
 };
 
@@ -195,6 +199,24 @@ Global::Global()
         .precision(0)
         ;
 
+    for (auto type : EventPool::types()) {
+        eventAllocs.emplace_back();
+        eventAllocs.back()
+            .method(type, &EventPool::Type::getAllocs)
+            .name("sim_events." + type->name + ".allocs")
+            .desc("Number of events of this type allocated from the pool")
+            .flags(Stats::nozero)
+            ;
+
+        eventsRecycled.emplace_back();
+        eventsRecycled.back()
+            .method(type, &EventPool::Type::getRecycled)
+            .name("sim_events." + type->name + ".recycled")
+            .desc("Number of these allocations served from the free lists")
+            .flags(Stats::nozero)
+            ;
+    }
+
     simSeconds = simTicks / simFreq;
     hostInstRate = simInsts / hostSeconds;
     hostOpRate = simOps / hostSeconds;
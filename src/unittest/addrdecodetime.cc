@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+/*
+ * Measures the address decoding of a crossbar that connects the given
+ * number of PEs, addressed like the DTU NoC by the core id in the upper
+ * byte. The addresses are drawn uniformly from all PEs and decoded once
+ * by the port map with the 3-entry cache that BaseXBar puts in front of
+ * it and once by the direct-indexed decode table. Both have to yield
+ * the same ports.
+ *
+ * Usage: addrdecodetime [<pes> [<lookups>]]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "base/addr_range_map.hh"
+#include "mem/addr_decoder.hh"
+
+using namespace std;
+
+static const unsigned coreShift = 56;
+
+struct PortCache
+{
+    bool valid;
+    PortID id;
+    AddrRange range;
+};
+
+// the same lookup as BaseXBar::findPort without the decode table
+static PortID
+mapLookup(const AddrRangeMap<PortID> &map, PortCache (&cache)[3], Addr addr)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (cache[i].valid && cache[i].range.contains(addr))
+            return cache[i].id;
+    }
+
+    auto it = map.find(addr);
+    if (it == map.end())
+        return InvalidPortID;
+
+    cache[2] = cache[1];
+    cache[1] = cache[0];
+    cache[0].valid = true;
+    cache[0].id = it->second;
+    cache[0].range = it->first;
+    return it->second;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned pes = argc > 1 ? atoi(argv[1]) : 64;
+    size_t lookups = argc > 2 ? atol(argv[2]) : 10000000;
+    if (pes == 0 || pes > 256) {
+        cerr << "Usage: " << argv[0] << " [<pes> [<lookups>]]" << endl;
+        return 1;
+    }
+
+    // one range per PE, plus a small device range as on the NoC
+    AddrRangeMap<PortID> map;
+    for (unsigned i = 0; i < pes; ++i) {
+        Addr base = static_cast<Addr>(i) << coreShift;
+        map.insert(RangeSize(base, static_cast<Addr>(1) << coreShift), i);
+    }
+    Addr dev = static_cast<Addr>(pes) << coreShift;
+    if (pes < 256)
+        map.insert(RangeSize(dev, 0x1000), pes);
+
+    AddrDecoder decoder(coreShift);
+    decoder.build(map);
+
+    mt19937_64 gen(1);
+    vector<Addr> addrs(lookups);
+    for (auto &a : addrs) {
+        a = (gen() % pes) << coreShift | (gen() & 0xFFFFFFFF);
+    }
+
+    cout << "Decoding " << lookups << " addresses for " << pes
+         << " PEs" << endl;
+
+    PortCache cache[3] = {};
+    vector<PortID> ports(lookups);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i)
+        ports[i] = mapLookup(map, cache, addrs[i]);
+    auto end = chrono::steady_clock::now();
+    double map_secs = chrono::duration<double>(end - start).count();
+
+    size_t wrong = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        PortID id = decoder.lookup(addrs[i]);
+        if (id == InvalidPortID)
+            id = mapLookup(map, cache, addrs[i]);
+        wrong += id != ports[i];
+    }
+    end = chrono::steady_clock::now();
+    double table_secs = chrono::duration<double>(end - start).count();
+
+    if (wrong) {
+        cerr << wrong << " addresses were decoded differently" << endl;
+        return 1;
+    }
+
+    // the device range does not cover a whole chunk
+    if (pes < 256 && decoder.lookup(dev) != InvalidPortID) {
+        cerr << "device range has been entered into the table" << endl;
+        return 1;
+    }
+
+    cout << "map:      " << lookups / map_secs / 1e6 << " M lookups/s" << endl;
+    cout << "table:    " << lookups / table_secs / 1e6 << " M lookups/s"
+         << endl;
+    cout << "speedup:  " << map_secs / table_secs << endl;
+    return 0;
+}
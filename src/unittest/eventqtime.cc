@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2015, Christian Menard
+ * Copyright (c) 2015, Nils Asmussen
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of the FreeBSD Project.
+ */
+
+/*
+ * Replays a recorded event schedule on the list-based event queue and
+ * on the calendar queue and reports the time spent for both. The
+ * schedule is recorded with --debug-flags=EventRecord, starting at
+ * tick 0. As the order in which the events are serviced is recorded
+ * as well, the replay also verifies that both backends produce
+ * exactly the same order.
+ *
+ * Usage: eventqtime <trace> [<queue name>]
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sim/eventq_impl.hh"
+
+using namespace std;
+
+struct Op
+{
+    char type;
+    size_t id;
+    Tick when;
+    int prio;
+};
+
+class ReplayEvent : public Event
+{
+  public:
+    size_t id;
+
+    ReplayEvent(size_t _id, Priority prio)
+        : Event(prio), id(_id)
+    {}
+
+    void process() {}
+    const char *description() const { return "replay"; }
+};
+
+static bool
+readTrace(const char *file, string queue, vector<Op> &ops, size_t &numIds)
+{
+    ifstream in(file);
+    if (!in) {
+        cerr << "Unable to open " << file << endl;
+        return false;
+    }
+
+    unordered_map<uint64_t, size_t> ids;
+    string line;
+    while (getline(in, line)) {
+        // <tick>: <queue>: <op> <event> [<when> <priority>]
+        istringstream is(line);
+        string tick, name;
+        Op op;
+        uint64_t ptr;
+        if (!(is >> tick >> name >> op.type >> hex >> ptr >> dec))
+            continue;
+        if (op.type != 'i' && op.type != 'r' && op.type != 's')
+            continue;
+
+        if (queue.empty())
+            queue = name;
+        else if (name != queue)
+            continue;
+
+        auto it = ids.find(ptr);
+        if (op.type == 'i') {
+            if (!(is >> op.when >> op.prio))
+                continue;
+            if (it == ids.end())
+                it = ids.insert(make_pair(ptr, ids.size())).first;
+        }
+        else if (it == ids.end()) {
+            cerr << "Unknown event " << hex << ptr << dec
+                 << "; the trace needs to start at tick 0" << endl;
+            return false;
+        }
+
+        op.id = it->second;
+        ops.push_back(op);
+    }
+
+    numIds = ids.size();
+    return true;
+}
+
+static bool
+replay(const vector<Op> &ops, size_t numIds, bool calendar, double &secs)
+{
+    useEventCalendar = calendar;
+    EventQueue eq(calendar ? "calendar" : "list");
+    vector<ReplayEvent *> events(numIds, NULL);
+    bool ok = true;
+
+    auto start = chrono::steady_clock::now();
+    for (auto &op : ops) {
+        ReplayEvent *&ev = events[op.id];
+        switch (op.type) {
+          case 'i':
+            // addresses of deleted events might be reused with a
+            // different priority
+            if (!ev || ev->priority() != op.prio) {
+                delete ev;
+                ev = new ReplayEvent(op.id, op.prio);
+            }
+            eq.schedule(ev, op.when);
+            break;
+
+          case 'r':
+            eq.deschedule(ev);
+            break;
+
+          case 's':
+            if (eq.empty() ||
+                static_cast<ReplayEvent*>(eq.getHead())->id != op.id) {
+                ok = false;
+                break;
+            }
+            eq.serviceOne();
+            break;
+        }
+
+        if (!ok)
+            break;
+    }
+    auto end = chrono::steady_clock::now();
+    secs = chrono::duration<double>(end - start).count();
+
+    while (!eq.empty())
+        eq.deschedule(eq.getHead());
+    for (auto ev : events)
+        delete ev;
+    return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <trace> [<queue name>]" << endl;
+        return 1;
+    }
+
+    vector<Op> ops;
+    size_t numIds;
+    if (!readTrace(argv[1], argc > 2 ? argv[2] : "", ops, numIds))
+        return 1;
+
+    cout << "Replaying " << ops.size() << " operations on "
+         << numIds << " events" << endl;
+
+    double secs[2];
+    for (int calendar = 0; calendar < 2; ++calendar) {
+        if (!replay(ops, numIds, calendar, secs[calendar])) {
+            cerr << (calendar ? "calendar" : "list")
+                 << ": serviced events differ from the trace" << endl;
+            return 1;
+        }
+
+        cout << (calendar ? "calendar: " : "list:     ")
+             << secs[calendar] << " s ("
+             << secs[calendar] * 1e9 / ops.size() << " ns/op)" << endl;
+    }
+
+    cout << "speedup:  " << secs[0] / secs[1] << endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+# either expressed or implied, of the FreeBSD Project.
+
+
+# Compares the host-side simulation speed of several variants of the same
+# simulation. Each variant is a set of additional arguments for the config
+# script, e.g. to compare the DTU with and without packet pooling:
+#
+#   util/dtu_host_speed.py -r 3 -v pool= -v nopool=--no-dtu-pool -- \
+#       build/X86/gem5.opt configs/example/dtu-fs.py --cmd=...
+#
+# The host_seconds and host_tick_rate stats of each run are taken from the
+# stats.txt of a separate output directory per run.
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+
+def read_stats(path):
+    stats = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'^(host_seconds|host_tick_rate|sim_ticks)\s+(\S+)', line)
+            if m:
+                stats[m.group(1)] = float(m.group(2))
+    return stats
+
+def run(gem5, config, outdir, args):
+    cmd = [gem5, '-d', outdir, config] + args
+    with open(os.devnull, 'w') as devnull:
+        subprocess.check_call(cmd, stdout=devnull, stderr=devnull)
+    return read_stats(os.path.join(outdir, 'stats.txt'))
+
+parser = optparse.OptionParser(
+    usage="%prog [options] -- <gem5 binary> <config> [config args]")
+parser.add_option("-v", "--variant", action="append", default=[],
+                  metavar="NAME=ARGS",
+                  help="a variant and its additional config arguments")
+parser.add_option("-r", "--runs", type="int", default=1,
+                  help="number of runs per variant [default: %default]")
+parser.add_option("-o", "--outdir", default="host-speed",
+                  help="directory for the outputs [default: %default]")
+
+(options, args) = parser.parse_args()
+
+if len(args) < 2 or len(options.variant) == 0:
+    parser.print_help()
+    sys.exit(1)
+
+gem5, config, common_args = args[0], args[1], args[2:]
+
+results = []
+for variant in options.variant:
+    name, _, extra = variant.partition('=')
+    seconds = []
+    rates = []
+    ticks = None
+    for i in range(0, options.runs):
+        outdir = os.path.join(options.outdir, '%s.%d' % (name, i))
+        stats = run(gem5, config, outdir, common_args + extra.split())
+        seconds.append(stats['host_seconds'])
+        rates.append(stats['host_tick_rate'])
+        if ticks is not None and ticks != stats['sim_ticks']:
+            print >>sys.stderr, "Warning: %s: simulated time differs " \
+                "between runs" % name
+        ticks = stats['sim_ticks']
+    # report the best of all runs to reduce the noise
+    results.append((name, min(seconds), max(rates), ticks))
+
+base = results[0][1]
+print "%-16s %12s %16s %16s %8s" % \
+    ('variant', 'host_seconds', 'host_tick_rate', 'sim_ticks', 'speedup')
+for (name, secs, rate, ticks) in results:
+    print "%-16s %12.2f %16.0f %16d %8.3f" % \
+        (name, secs, rate, ticks, base / secs)
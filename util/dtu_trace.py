@@ -0,0 +1,216 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+# either expressed or implied, of the FreeBSD Project.
+
+
+# Analyzes the binary event traces of the DTUs (enabled with Dtu.trace = True),
+# which are written to <dtu name>.trace in the output directory. For example:
+#
+#   util/dtu_trace.py m5out/*.dtu.trace
+#   util/dtu_trace.py -t -n 20 m5out/pe0.dtu.trace m5out/pe1.dtu.trace
+#
+# The records of all given files are merged to reconstruct the timeline of
+# each message: from starting the SEND/REPLY command at the sender, over
+# sending it to the NoC, its arrival at the receiver and the response, until
+# the command is finished. The slowest messages are printed along with the
+# phase that dominated their latency.
+
+import optparse
+import struct
+import sys
+
+MAGIC = 'DTUTRACE'
+VERSION = 1
+RECORD = struct.Struct('<QQIBBBBBBBB')
+
+EVENTS = ['CMD_START', 'CMD_FINISH', 'NOC_SEND', 'NOC_RECV', 'NOC_RESP',
+          'BUF_ALLOC', 'BUF_FREE', 'CREDITS']
+OPCODES = ['IDLE', 'SEND', 'REPLY', 'READ', 'WRITE', 'INC_READ_PTR',
+           'WAKEUP_CORE', 'ATOMIC']
+NOC_MESSAGE = 0
+
+PHASES = [('local', 'command start until sent to the NoC'),
+          ('noc', 'sent to the NoC until arrival at the receiver'),
+          ('ack', 'arrival at the receiver until the response'),
+          ('finish', 'response until the command is finished')]
+
+class Record(object):
+    def __init__(self, fields):
+        (self.tick, self.arg, self.size, event, self.core, self.ep,
+         self.slot, self.peer, self.kind, self.error, _) = fields
+        self.event = EVENTS[event] if event < len(EVENTS) else str(event)
+
+def read_trace(path):
+    with open(path, 'rb') as f:
+        header = f.read(16)
+        if len(header) < 16 or header[0:8] != MAGIC:
+            raise Exception('%s: no DTU trace' % path)
+        version, size = struct.unpack('<II', header[8:16])
+        if version != VERSION or size != RECORD.size:
+            raise Exception('%s: unsupported version %d (record size %d)' %
+                            (path, version, size))
+        while True:
+            data = f.read(RECORD.size * 4096)
+            if not data:
+                break
+            for off in range(0, len(data) - RECORD.size + 1, RECORD.size):
+                yield Record(RECORD.unpack_from(data, off))
+
+class Message(object):
+    def __init__(self, sender, start):
+        self.sender = sender
+        self.start = start
+        self.receiver = None
+        self.opcode = None
+        self.size = 0
+        self.sends = []
+        self.recv = None
+        self.resp = None
+        self.finish = None
+        self.error = 0
+
+    def complete(self):
+        return self.sends and self.recv is not None and \
+            self.resp is not None and self.finish is not None
+
+    def phases(self):
+        return [self.sends[0] - self.start,
+                self.recv - self.sends[-1],
+                self.resp - self.recv,
+                self.finish - self.resp]
+
+    def latency(self):
+        return self.finish - self.start
+
+def analyze(records):
+    # messages are identified by the sender core and the start of the command
+    msgs = {}
+    cmds = {}
+    def msg(core, start):
+        key = (core, start)
+        if key not in msgs:
+            msgs[key] = Message(core, start)
+        return msgs[key]
+
+    for r in records:
+        if r.event == 'CMD_FINISH':
+            name = OPCODES[r.kind] if r.kind < len(OPCODES) else str(r.kind)
+            cmds.setdefault(name, []).append(r.tick - r.arg)
+            if name in ('SEND', 'REPLY'):
+                m = msg(r.core, r.arg)
+                m.opcode = name
+                m.finish = r.tick
+                m.error = r.error
+        elif r.kind == NOC_MESSAGE and r.event == 'NOC_SEND':
+            m = msg(r.core, r.arg)
+            m.sends.append(r.tick)
+            m.receiver = r.peer
+            m.size = r.size
+        elif r.kind == NOC_MESSAGE and r.event == 'NOC_RECV':
+            # only the last attempt has been accepted
+            msg(r.peer, r.arg).recv = r.tick
+        elif r.kind == NOC_MESSAGE and r.event == 'NOC_RESP':
+            msg(r.core, r.arg).resp = r.tick
+    return msgs, cmds
+
+def fmt(ticks, period):
+    if period:
+        return '%.1f' % (float(ticks) / period)
+    return '%d' % ticks
+
+def avg(vals):
+    return sum(vals) / float(len(vals)) if vals else 0
+
+parser = optparse.OptionParser(usage="%prog [options] <trace>...")
+parser.add_option("-n", "--num", type="int", default=10,
+                  help="number of slowest messages to print [default: %default]")
+parser.add_option("-p", "--period", type="int", default=0,
+                  help="clock period in ticks to print cycles instead of ticks")
+parser.add_option("-t", "--timeline", action="store_true",
+                  help="print the timeline of every message")
+
+(options, args) = parser.parse_args()
+
+if len(args) == 0:
+    parser.print_help()
+    sys.exit(1)
+
+records = []
+for path in args:
+    records.extend(read_trace(path))
+records.sort(key=lambda r: r.tick)
+
+msgs, cmds = analyze(records)
+complete = [m for m in msgs.values() if m.complete()]
+unit = 'cycles' if options.period else 'ticks'
+
+print "Commands (%s):" % unit
+print "  %-14s %10s %12s %12s" % ('opcode', 'count', 'avg', 'max')
+for name in sorted(cmds.keys()):
+    times = cmds[name]
+    print "  %-14s %10d %12s %12s" % \
+        (name, len(times), fmt(avg(times), options.period),
+         fmt(max(times), options.period))
+print
+
+if options.timeline:
+    print "Message timelines (%s, relative to the command start):" % unit
+    for m in sorted(complete, key=lambda m: m.start):
+        print "  %s pe%d -> pe%d @ %d: send %s, recv %s, resp %s, finish %s%s" % \
+            (m.opcode, m.sender, m.receiver, m.start,
+             ','.join(fmt(t - m.start, options.period) for t in m.sends),
+             fmt(m.recv - m.start, options.period),
+             fmt(m.resp - m.start, options.period),
+             fmt(m.finish - m.start, options.period),
+             ' (error %d)' % m.error if m.error else '')
+    print
+
+print "Messages: %d complete, %d incomplete" % \
+    (len(complete), len(msgs) - len(complete))
+if complete:
+    print "  %-8s %12s  %s" % ('phase', 'avg', 'description')
+    for i, (name, desc) in enumerate(PHASES):
+        print "  %-8s %12s  %s" % \
+            (name, fmt(avg([m.phases()[i] for m in complete]), options.period), desc)
+    print "  %-8s %12s" % \
+        ('total', fmt(avg([m.latency() for m in complete]), options.period))
+    print
+
+    print "Slowest messages (%s):" % unit
+    print "  %-6s %5s %5s %14s %10s %8s %10s  %s" % \
+        ('opcode', 'from', 'to', 'start', 'latency', 'retries', 'critical', 'phases')
+    slowest = sorted(complete, key=lambda m: m.latency(), reverse=True)
+    for m in slowest[0:options.num]:
+        phases = m.phases()
+        crit = phases.index(max(phases))
+        print "  %-6s %5d %5d %14d %10s %8d %10s  %s" % \
+            (m.opcode, m.sender, m.receiver, m.start,
+             fmt(m.latency(), options.period), len(m.sends) - 1,
+             PHASES[crit][0],
+             ' '.join(fmt(p, options.period) for p in phases))
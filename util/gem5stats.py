@@ -0,0 +1,189 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Christian Menard
+# Copyright (c) 2015 Nils Asmussen
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# The views and conclusions contained in the software and documentation are those
+# of the authors and should not be interpreted as representing official policies,
+
+
+# Reads the binary statistics (see src/base/stats/binary.hh), which are written
+# instead of the text statistics with --stats-format=binary. It can be used as
+# a library:
+#
+#   import gem5stats
+#   stats = gem5stats.load('m5out/stats.bin')
+#   ticks, values = stats.series('system.pe0.dtu.xfer.transfers')
+#   for name, values in stats.select('system.pe*.dtu.xfer.transfers'):
+#       ...
+#
+# or from the command line to list the columns or to print selected ones as
+# CSV, one line per dump:
+#
+#   util/gem5stats.py m5out/stats.bin
+#   util/gem5stats.py -c 'system.pe*.dtu.xfer.*' m5out/stats.bin
+
+from __future__ import print_function
+
+import array
+import fnmatch
+import optparse
+import struct
+import sys
+
+MAGIC = b'GEM5STAT'
+VERSION = 1
+SCHEMA = 1
+DUMP = 2
+
+HEADER = struct.Struct('<8sII')
+BLOCK = struct.Struct('<II')
+DUMP_HEADER = struct.Struct('<QI')
+NAME_LEN = struct.Struct('<H')
+
+class Stats(object):
+    """The contents of a binary statistics file.
+
+    ticks holds the tick of every dump. The values of a dump are stored
+    in the layout of its schema, so that loading is fast; series() and
+    select() gather them by column name. Columns that are missing in a
+    dump (because the layout changed) are NaN.
+    """
+
+    def __init__(self):
+        self.ticks = []
+        # the column names and the index of each name per schema
+        self.schemas = {}
+        # per dump: the schema and the values
+        self.dumps = []
+
+    def columns(self):
+        """Returns all column names in the order of their first appearance."""
+        seen = set()
+        names = []
+        for sid in sorted(self.schemas.keys()):
+            for name in self.schemas[sid][0]:
+                if name not in seen:
+                    seen.add(name)
+                    names.append(name)
+        return names
+
+    def series(self, name):
+        """Returns the ticks and the values of column <name> of all dumps."""
+        values = []
+        for sid, row in self.dumps:
+            idx = self.schemas[sid][1].get(name)
+            values.append(row[idx] if idx is not None else float('nan'))
+        return self.ticks, values
+
+    def select(self, pattern):
+        """Returns (name, values) for all columns matching the shell-style
+        <pattern>, e.g., 'system.pe*.dtu.*'."""
+        return [(name, self.series(name)[1])
+                for name in fnmatch.filter(self.columns(), pattern)]
+
+    def last(self, name):
+        """Returns the value of column <name> in the last dump."""
+        return self.series(name)[1][-1]
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    magic, version, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise Exception('%s: no binary statistics' % path)
+    if version != VERSION:
+        raise Exception('%s: unsupported version %d' % (path, version))
+
+    stats = Stats()
+    off = HEADER.size
+    while off + BLOCK.size <= len(data):
+        btype, sid = BLOCK.unpack_from(data, off)
+        off += BLOCK.size
+        if btype == SCHEMA:
+            count, = struct.unpack_from('<I', data, off)
+            off += 4
+            names = []
+            for _ in range(count):
+                length, = NAME_LEN.unpack_from(data, off)
+                off += NAME_LEN.size
+                names.append(data[off:off + length].decode('utf-8'))
+                off += length
+            stats.schemas[sid] = (names, dict((n, i) for i, n in enumerate(names)))
+        elif btype == DUMP:
+            tick, count = DUMP_HEADER.unpack_from(data, off)
+            off += DUMP_HEADER.size
+            end = off + count * 8
+            if end > len(data):
+                # the simulator has been interrupted while writing
+                break
+            row = array.array('d')
+            if hasattr(row, 'frombytes'):
+                row.frombytes(data[off:end])
+            else:
+                row.fromstring(data[off:end])
+            if sys.byteorder != 'little':
+                row.byteswap()
+            off = end
+            stats.ticks.append(tick)
+            stats.dumps.append((sid, row))
+        else:
+            raise Exception('%s: unknown block type %d at offset %d' %
+                            (path, btype, off - BLOCK.size))
+    return stats
+
+if __name__ == '__main__':
+    parser = optparse.OptionParser(usage="%prog [options] <stats file>")
+    parser.add_option("-c", "--columns", action="append", default=[],
+                      help="print the columns matching the given pattern as CSV "
+                           "(can be given multiple times)")
+    parser.add_option("-l", "--last", action="store_true",
+                      help="only print the last dump")
+
+    (options, args) = parser.parse_args()
+
+    if len(args) != 1:
+        parser.print_help()
+        sys.exit(1)
+
+    stats = load(args[0])
+
+    if not options.columns:
+        print("%d dumps, %d columns:" % (len(stats.ticks), len(stats.columns())))
+        for name in stats.columns():
+            print("  %s" % name)
+        sys.exit(0)
+
+    selected = []
+    for pattern in options.columns:
+        selected.extend(stats.select(pattern))
+
+    print(','.join(['tick'] + [name for name, _ in selected]))
+    rows = range(len(stats.ticks))
+    if options.last:
+        rows = rows[-1:]
+    for i in rows:
+        print(','.join([str(stats.ticks[i])] +
+                       ['%g' % values[i] for _, values in selected]))